@@ -1,7 +1,11 @@
 #ifndef ADAPTIVE_THRESHOLDING_H
 #define ADAPTIVE_THRESHOLDING_H
 
+#include <cstdint>
 #include <string>
+#include <binarization/engine_autotune.h>
+#include <binarization/integral_image.h>
+#include <binarization/postprocessing.h>
 
 // Sauvola-Binarisierung
 void sauvola_binarize(const unsigned char* gray, unsigned char* out, int width, int height, int window_size, float k, float R);
@@ -9,7 +13,33 @@ void sauvola_binarize(const unsigned char* gray, unsigned char* out, int width,
 // NICK-Binarisierung
 void nick_binarize(const unsigned char* gray, unsigned char* out, int width, int height, int window_size, float k);
 
-// Prozess zur Ausführung von Sauvola und NICK-Binarisierung
-void process_advanced_binarization(const std::string &input_path,int window_size, float k, float R);
+// 16-Bit-Varianten (Ausgabe 0/255, R im 16-Bit-Wertebereich)
+void sauvola_binarize(const uint16_t* gray, unsigned char* out, int width, int height, int window_size, float k, float R);
+void nick_binarize(const uint16_t* gray, unsigned char* out, int width, int height, int window_size, float k);
+
+// Verfahren der lokalen Schwellwertbildung
+enum class AdaptiveMethod { Sauvola, Nick };
+
+// Ein Verfahren auf einer fertigen Graustufenebene, naiv oder mit deren Integralbild (integral != nullptr),
+// Ausgabe wie process_advanced_binarization; liefert die Rechenzeit der Schwellwertbildung in Sekunden
+template <typename Pixel>
+double adaptive_method_gray(const std::string &input_path, AdaptiveMethod method, const Pixel *gray,
+                            int width, int height, const BasicIntegralImage<Pixel> *integral,
+                            int window_size, float k, float R, const PostprocessOptions &postprocess);
+
+// Sauvola und NICK auf einer fertigen (ggf. geradegerichteten) Graustufenebene mit bereits aufgelöster
+// Engine (choose_engine), Ausgabe wie process_advanced_binarization (Pixel: uint8_t oder uint16_t)
+template <typename Pixel>
+void advanced_binarization_gray(const std::string &input_path, const Pixel *gray, int width, int height,
+                                int window_size, float k, float R, const EngineChoice &choice,
+                                const PostprocessOptions &postprocess);
+
+// Prozess zur Ausführung von Sauvola und NICK-Binarisierung (8- oder 16-Bit-Eingabe, R in 8-Bit-Einheiten;
+// Engine naiv, Integralbild oder automatisch, optional mit Geraderichten (max_skew > 0, Grad)
+// und Nachbearbeitung: Morphologie, Komponentenstatistik, Flächenfilter)
+void process_advanced_binarization(const std::string &input_path,int window_size, float k, float R,
+                                   BinarizationEngine engine = BinarizationEngine::Naive,
+                                   const std::string &calibration_path = DEFAULT_CALIBRATION_PATH,
+                                   const PostprocessOptions &postprocess = {}, float max_skew = 0.0f);
 
 #endif // ADAPTIVE_THRESHOLDING_H
@@ -0,0 +1,40 @@
+#ifndef CONNECTED_COMPONENTS_H
+#define CONNECTED_COMPONENTS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <binarization/morphology.h>
+
+// Lauf von Tintenpixeln in Zeile y: Spalten [x_begin, x_end)
+struct PixelRun {
+    int y;
+    int x_begin;
+    int x_end;
+};
+
+// Statistik einer Zusammenhangskomponente (Bounding Box inklusive)
+struct ComponentStats {
+    int64_t area;
+    int x_min, y_min, x_max, y_max;
+    double centroid_x, centroid_y;
+};
+
+// Ergebnis der Labelung: Läufe in Rasterreihenfolge, Komponente je Lauf, Statistik je Komponente
+struct ComponentLabeling {
+    std::vector<PixelRun> runs;
+    std::vector<int32_t> run_labels;
+    std::vector<ComponentStats> components;
+};
+
+// Lauflängenbasierte Labelung (8er-Nachbarschaft), streifenweise parallel mit nebenläufigem Union-Find
+void label_components(const PackedBinaryImage &image, ComponentLabeling &labeling);
+
+// Entfernt Komponenten mit weniger als min_area Pixeln aus dem 0/255-Bild; gibt die Anzahl zurück
+int remove_small_components(unsigned char *binary, int width, const ComponentLabeling &labeling, int64_t min_area);
+
+// Schreibt die Statistik aller Komponenten ab min_area Pixeln als CSV
+// (label,area,x_min,y_min,x_max,y_max,centroid_x,centroid_y)
+bool write_component_stats(const std::string &path, const ComponentLabeling &labeling, int64_t min_area = 0);
+
+#endif // CONNECTED_COMPONENTS_H
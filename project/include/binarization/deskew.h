@@ -0,0 +1,24 @@
+#ifndef DESKEW_H
+#define DESKEW_H
+
+#include <cstdint>
+#include <binarization/morphology.h>
+
+// Schräglage der Textzeilen in Grad (positiv = Zeilen fallen nach rechts ab, Bildkoordinaten)
+// aus Projektionsprofilen der Bitebene; grob-fein-Suche über [-max_angle, max_angle]
+float estimate_skew(const PackedBinaryImage &image, float max_angle = 5.0f,
+                    float coarse_step = 0.5f, float fine_step = 0.05f);
+
+// Dreht ein 8- bzw. 16-Bit-Bild um angle Grad (Vorzeichen wie estimate_skew) mit drei Scherungen;
+// Bildgröße bleibt erhalten, frei werdende Pixel erhalten fill. output darf nicht input sein.
+void rotate_shear(const unsigned char *input, unsigned char *output, int width, int height,
+                  float angle, unsigned char fill = 255);
+void rotate_shear(const uint16_t *input, uint16_t *output, int width, int height,
+                  float angle, uint16_t fill = 65535);
+
+// Schätzt die Schräglage eines Graustufenbildes (Pixel unter halbem Wertebereich = Tinte) und richtet es
+// in-place gerade; gibt den Winkel zurück
+float deskew_gray(unsigned char *gray, int width, int height, float max_angle = 5.0f);
+float deskew_gray(uint16_t *gray, int width, int height, float max_angle = 5.0f);
+
+#endif // DESKEW_H
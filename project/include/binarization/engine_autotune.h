@@ -0,0 +1,33 @@
+#ifndef ENGINE_AUTOTUNE_H
+#define ENGINE_AUTOTUNE_H
+
+#include <string>
+
+// Verfahren zur Berechnung der lokalen Statistik (Sauvola/NICK)
+enum class BinarizationEngine {
+    Naive,     // local_mean_std, O(window^2) pro Pixel
+    Integral,  // IntegralImage, O(1) pro Pixel plus Aufbau
+    Auto       // Auswahl über das kalibrierte Kostenmodell
+};
+
+// Gewählte Engine und Threadanzahl für einen Auftrag
+struct EngineChoice {
+    BinarizationEngine engine;
+    int threads;
+};
+
+// Standardpfad der Kalibrierungsdatei
+extern const char* const DEFAULT_CALIBRATION_PATH;
+
+// Name <-> Engine ("naive", "integral", "auto")
+bool parse_engine(const std::string &name, BinarizationEngine &engine);
+const char* engine_name(BinarizationEngine engine);
+
+// Einmalige Kalibrierung: misst die Kosten pro Pixel und schreibt sie nach calibration_path
+bool calibrate_engines(const std::string &calibration_path);
+
+// Löst eine Engine (ggf. Auto) für Bildgröße und Fenstergröße auf; kalibriert bei fehlender Datei
+EngineChoice choose_engine(BinarizationEngine requested, int width, int height, int window_size,
+                           const std::string &calibration_path);
+
+#endif // ENGINE_AUTOTUNE_H
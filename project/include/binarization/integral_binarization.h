@@ -2,11 +2,39 @@
 #define INTEGRAL_BINARIZATION_H
 
 #include <string>
+#include <vector>
+#include <binarization/integral_image.h>
+#include <binarization/postprocessing.h>
 
 // Sauvola-Binarisierung mit Integralbildern
 void sauvola_binarize_integral(const unsigned char* gray, unsigned char* out, int width, int height, int window_size, float k = 0.2f, float R = 128.0f);
 
-// Prozess zur Berechnung von Integralbildern und Durchführung der Binarisierung
-void process_integral_binarization(const std::string &input_path, int window_size, float k, float R);
+// Sauvola- und NICK-Binarisierung auf einem bereits aufgebauten Integralbild
+void sauvola_binarize_integral(const IntegralImage& integral, const unsigned char* gray, unsigned char* out, int window_size, float k = 0.2f, float R = 128.0f);
+void nick_binarize_integral(const IntegralImage& integral, const unsigned char* gray, unsigned char* out, int window_size, float k = 0.2f);
+
+// 16-Bit-Varianten (Ausgabe weiterhin 0/255, R im 16-Bit-Wertebereich, z. B. 128 * 257)
+void sauvola_binarize_integral(const IntegralImage16& integral, const uint16_t* gray, unsigned char* out, int window_size, float k, float R);
+void nick_binarize_integral(const IntegralImage16& integral, const uint16_t* gray, unsigned char* out, int window_size, float k = 0.2f);
+
+// Sauvola und NICK für eine Fenstergröße auf einem fertigen Integralbild (window_suffix: "_w<Größe>"
+// an die Ausgabenamen anhängen); liefert die Rechenzeit der Schwellwertpässe in Sekunden
+template <typename Pixel>
+double integral_window_gray(const std::string &input_path, const BasicIntegralImage<Pixel> &integral,
+                            const Pixel *gray, int window_size, bool window_suffix, float k, float R,
+                            const PostprocessOptions &postprocess);
+
+// Sauvola und NICK für alle Fenstergrößen auf einem fertigen Integralbild, Ausgabe wie
+// process_integral_binarization; liefert die Rechenzeit der Schwellwertpässe in Sekunden
+template <typename Pixel>
+double integral_binarization_gray(const std::string &input_path, const BasicIntegralImage<Pixel> &integral,
+                                  const Pixel *gray, const std::vector<int> &window_sizes, float k, float R,
+                                  const PostprocessOptions &postprocess);
+
+// Prozess zur Berechnung von Integralbildern und Durchführung der Binarisierung (ein Integralbild für alle Fenstergrößen,
+// 16-Bit-Eingaben werden ohne Reduktion auf 8 Bit verarbeitet, R bleibt in 8-Bit-Einheiten,
+// optional mit Geraderichten (max_skew > 0, Grad) und Nachbearbeitung: Morphologie, Komponentenstatistik, Flächenfilter)
+void process_integral_binarization(const std::string &input_path, const std::vector<int> &window_sizes, float k, float R,
+                                   const PostprocessOptions &postprocess = {}, float max_skew = 0.0f);
 
 #endif // INTEGRAL_BINARIZATION_H
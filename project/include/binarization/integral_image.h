@@ -0,0 +1,67 @@
+#ifndef INTEGRAL_IMAGE_H
+#define INTEGRAL_IMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <utils/plane_arena.h>
+#include <utils/pixel_traits.h>
+
+// Integralbild (Summe und Quadratsumme), einmal pro Bild aufgebaut und für
+// beliebige Fenstergrößen und Schwellwertformeln wiederverwendbar.
+// Pixel: uint8_t (32-Bit-Summenebene) oder uint16_t (64-Bit-Summenebene)
+template <typename Pixel>
+class BasicIntegralImage {
+public:
+    using sum_type = typename PixelTraits<Pixel>::sum_type;
+
+    BasicIntegralImage() = default;
+    BasicIntegralImage(const Pixel* gray, int width, int height);
+
+    // (Neu-)Aufbau aus einem Graustufenbild
+    void build(const Pixel* gray, int width, int height);
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    bool empty() const { return width_ == 0 || height_ == 0; }
+
+    // Zeilenabstand der gepolsterten Ebenen (width + 1)
+    size_t stride() const { return stride_; }
+
+    // Gepolsterte Ebenen: Eintrag (x + 1, y + 1) enthält die Summe über [0, x] x [0, y]
+    const sum_type* sum_plane() const { return sum_.data(); }
+    const uint64_t* sum_sq_plane() const { return sum_sq_.data(); }
+
+    // Summe bzw. Quadratsumme über [x1, x2] x [y1, y2] (Grenzen müssen im Bild liegen)
+    uint64_t sum(int x1, int y1, int x2, int y2) const;
+    uint64_t sum_sq(int x1, int y1, int x2, int y2) const;
+
+    // Mittelwert und Standardabweichung des am Bildrand abgeschnittenen Fensters um (x, y)
+    void mean_std(int x, int y, int half_win, float &mean, float &stddev) const;
+    void mean_variance(int x, int y, int half_win, float &mean, float &variance) const;
+
+private:
+    int width_ = 0;
+    int height_ = 0;
+    size_t stride_ = 1;
+    // Aus der Arena, nicht vorinitialisiert: build() schreibt jede Zeile im Band ihres Threads
+    Plane<sum_type> sum_;
+    Plane<uint64_t> sum_sq_;
+};
+
+// Zähler der Varianz area * sum_sq - sum^2: exakt in 64 Bit für 8-Bit-Bilder,
+// in double für 16-Bit-Bilder (dort kann er bei großen Fenstern 64 Bit überschreiten)
+template <typename Pixel>
+inline double variance_numerator(uint64_t area, uint64_t sum, uint64_t sum_sq) {
+    if constexpr (sizeof(Pixel) == 1) {
+        return static_cast<double>(area * sum_sq - sum * sum);
+    } else {
+        return static_cast<double>(area) * static_cast<double>(sum_sq) -
+               static_cast<double>(sum) * static_cast<double>(sum);
+    }
+}
+
+using IntegralImage = BasicIntegralImage<uint8_t>;
+using IntegralImage16 = BasicIntegralImage<uint16_t>;
+
+#endif // INTEGRAL_IMAGE_H
@@ -0,0 +1,54 @@
+#ifndef MORPHOLOGY_H
+#define MORPHOLOGY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Morphologische Nachbearbeitung (Vordergrund = Tinte, d. h. Pixelwert 0 im Binärbild)
+enum class MorphologyOp {
+    None,
+    Erode,   // Tinte schrumpft
+    Dilate,  // Tinte wächst
+    Open,    // Erosion, dann Dilatation: entfernt Flecken
+    Close    // Dilatation, dann Erosion: schließt unterbrochene Striche
+};
+
+// Operation mit rechteckigem Strukturelement width x height
+struct MorphologySpec {
+    MorphologyOp op = MorphologyOp::None;
+    int width = 3;
+    int height = 3;
+};
+
+// Bitgepacktes Binärbild: 64 Pixel pro Wort (Bit i von Wort j = Pixel 64 * j + i), Bit gesetzt = Tinte
+struct PackedBinaryImage {
+    int width = 0;
+    int height = 0;
+    int words_per_row = 0;
+    std::vector<uint64_t> bits;
+
+    uint64_t *row(int y) { return bits.data() + static_cast<size_t>(y) * words_per_row; }
+    const uint64_t *row(int y) const { return bits.data() + static_cast<size_t>(y) * words_per_row; }
+};
+
+// Name <-> Operation ("none", "erode", "dilate", "open", "close")
+bool parse_morphology_op(const std::string &name, MorphologyOp &op);
+const char* morphology_op_name(MorphologyOp op);
+
+// Strukturelement "WxH" oder "N" (quadratisch) einlesen
+bool parse_structuring_element(const std::string &value, int &width, int &height);
+
+// 0/255-Bild <-> Bitebene (Pixel < 128 gilt als Tinte)
+void pack_binary(const unsigned char *binary, int width, int height, PackedBinaryImage &packed);
+void unpack_binary(const PackedBinaryImage &packed, unsigned char *binary);
+
+// Erosion/Dilatation einer Bitebene mit zerlegtem Rechteck-Strukturelement (Pixel außerhalb sind neutral)
+void erode_packed(PackedBinaryImage &image, int se_width, int se_height);
+void dilate_packed(PackedBinaryImage &image, int se_width, int se_height);
+
+// Wendet spec in-place auf eine Bitebene bzw. ein 0/255-Binärbild an (keine Wirkung bei MorphologyOp::None)
+void apply_morphology(PackedBinaryImage &image, const MorphologySpec &spec);
+void apply_morphology(unsigned char *binary, int width, int height, const MorphologySpec &spec);
+
+#endif // MORPHOLOGY_H
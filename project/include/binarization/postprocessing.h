@@ -0,0 +1,22 @@
+#ifndef POSTPROCESSING_H
+#define POSTPROCESSING_H
+
+#include <cstdint>
+#include <string>
+#include <binarization/morphology.h>
+
+// Nachbearbeitung eines Binarisierungsergebnisses
+struct PostprocessOptions {
+    MorphologySpec morphology;     // Morphologie auf der Tinte
+    bool component_stats = false;  // Komponentenstatistik als CSV neben das Ausgabebild schreiben
+    int64_t min_area = 0;          // Komponenten mit weniger Pixeln entfernen (0 = aus)
+};
+
+// Pfad der Komponentenstatistik zu einem Ausgabebild (<stem>_components.csv)
+std::string component_stats_path(const std::string &output_path);
+
+// Wendet options in-place auf ein 0/255-Binärbild an (Bitebene wird nur einmal gepackt)
+void postprocess_binary(unsigned char *binary, int width, int height, const PostprocessOptions &options,
+                        const std::string &output_path);
+
+#endif // POSTPROCESSING_H
@@ -0,0 +1,26 @@
+#ifndef QUALITY_METRICS_H
+#define QUALITY_METRICS_H
+
+#include <cstdint>
+#include <vector>
+
+// Gütemaße einer Binarisierung gegenüber der Referenz (DIBCO), Tinte = Pixelwert 0;
+// Precision, Recall und F-Maße in Prozent
+struct QualityMetrics {
+    double precision = 0.0;
+    double recall = 0.0;
+    double f_measure = 0.0;
+    double pseudo_recall = 0.0;     // Recall auf dem Skelett der Referenz
+    double pseudo_f_measure = 0.0;
+    double psnr = 0.0;              // dB, 100 bei identischen Bildern
+    double drd = 0.0;               // Distance-Reciprocal Distortion (kleiner ist besser)
+};
+
+// Skelett der Tinte (Zhang-Suen-Verdünnung), Ergebnis 1 = Skelettpixel
+void skeletonize(const unsigned char *binary, int width, int height, std::vector<uint8_t> &skeleton);
+
+// Vergleich zweier 0/255-Bilder gleicher Größe
+QualityMetrics evaluate_binarization(const unsigned char *result, const unsigned char *ground_truth,
+                                     int width, int height);
+
+#endif // QUALITY_METRICS_H
@@ -1,6 +1,7 @@
 #ifndef THRESHOLDING_H
 #define THRESHOLDING_H
 
+#include <cstdint>
 #include <string>
 
 // Klassische Schwellenwert-Binarisierung (sequentiell)
@@ -9,4 +10,13 @@ void binarize_image(const std::string &input_path, std::string output_path, int
 // Parallele Schwellenwert-Binarisierung mit OpenMP
 void binarize_image_parallel(const std::string &input_path, std::string output_path, int threshold);
 
+// Schwellenwert auf ein bereits dekodiertes Bild (uint8_t oder uint16_t) anwenden und schreiben (für -m all)
+template <typename Pixel>
+void binarize_decoded_image(const std::string &input_path, std::string output_path, const Pixel *image,
+                            int width, int height, int channels, int threshold, bool parallel);
+
+// Kernel ohne Ein-/Ausgabe: Luminanz jedes Pixels gegen threshold, Ergebnis in allen Kanälen (Alpha = 255)
+void binarize_pixels(const unsigned char *image, unsigned char *out, int pixels, int channels,
+                     int threshold, bool parallel);
+
 #endif // THRESHOLDING_H
@@ -1,9 +1,23 @@
 #ifndef ADAPTIVE_MEDIAN_FILTER_H
 #define ADAPTIVE_MEDIAN_FILTER_H
 
+#include <cstdint>
 #include <string>
 
-// Adaptiver Median-Filter zur Rauschunterdrückung
-void adaptive_median_filter(const std::string &input_path, std::string output_path);
+// Adaptiver Median-Filter zur Rauschunterdrückung (color: RGB-Kanäle getrennt filtern statt Graustufen,
+// impulse_map: nur vorab erkannte Impuls-Kandidaten filtern, alle anderen Pixel unverändert übernehmen;
+// 16-Bit-Bilder werden mit voller Genauigkeit gefiltert und als 16-Bit-PNG/PGM/PPM geschrieben)
+void adaptive_median_filter(const std::string &input_path, std::string output_path, bool color = false, bool impulse_map = false);
+
+// Wie adaptive_median_filter für ein bereits dekodiertes Bild (uint8_t oder uint16_t, für -m all);
+// gray: schon berechnete Graustufenebene des Bildes (nullptr = hier umwandeln, im Farbmodus ignoriert)
+template <typename Pixel>
+void adaptive_median_filter_decoded(const std::string &input_path, std::string output_path, const Pixel *image,
+                                    int width, int height, int channels, bool color = false, bool impulse_map = false,
+                                    const Pixel *gray = nullptr);
+
+// Kernel ohne Ein-/Ausgabe: filtert eine Graustufenebene mit Fenstergrößen min_win_size .. max_window_size
+void adaptive_median_filter_process(const unsigned char *input, unsigned char *output,
+                                    int width, int height, int channels, int min_win_size, int max_window_size);
 
 #endif // ADAPTIVE_MEDIAN_FILTER_H
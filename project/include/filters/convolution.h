@@ -0,0 +1,46 @@
+#ifndef CONVOLUTION_H
+#define CONVOLUTION_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Randbehandlung außerhalb des Bildes
+enum class BorderMode {
+    Replicate, // Randpixel wiederholen (aaa|abc)
+    Reflect,   // Spiegeln ohne Randpixel (cb|abc)
+    Constant   // mit 0 auffüllen
+};
+
+// Separabler Festkomma-Kern ungerader Länge; Summe der Gewichte höchstens 257 (16-Bit-Zwischenwerte)
+struct SeparableKernel {
+    std::vector<uint16_t> taps;
+};
+
+// Name <-> Randbehandlung ("replicate", "reflect", "constant")
+bool parse_border_mode(const std::string &name, BorderMode &mode);
+
+// Gauß-Kern (Radius 3 sigma, Gewichte auf Summe 256 quantisiert) und Box-Kern der Größe size
+SeparableKernel gaussian_kernel(float sigma);
+SeparableKernel box_kernel(int size);
+
+// Separable Faltung eines 8-Bit-Kanals (horizontal, dann vertikal), gekachelt und parallel
+void convolve_separable(const unsigned char *input, unsigned char *output, int width, int height,
+                        const SeparableKernel &horizontal, const SeparableKernel &vertical,
+                        BorderMode border = BorderMode::Replicate);
+
+// Bibliotheksaufrufe für andere Stufen (z. B. Glättung vor der Binarisierung)
+void gaussian_blur(const unsigned char *input, unsigned char *output, int width, int height,
+                   float sigma, BorderMode border = BorderMode::Replicate);
+void box_blur(const unsigned char *input, unsigned char *output, int width, int height,
+              int size, BorderMode border = BorderMode::Replicate);
+
+// Sobel-Gradientenbetrag als L1-Norm (|gx| + |gy|) / 4, auf 255 begrenzt
+void sobel_magnitude(const unsigned char *input, unsigned char *output, int width, int height,
+                     BorderMode border = BorderMode::Replicate);
+
+// CLI-Methoden gaussian, box und sobel (color: R, G, B getrennt falten; sobel immer Graustufen)
+void process_convolution(const std::string &input_path, std::string output_path, const std::string &method,
+                         float sigma, int size, BorderMode border, bool color = false);
+
+#endif // CONVOLUTION_H
@@ -0,0 +1,29 @@
+#ifndef ALL_METHODS_H
+#define ALL_METHODS_H
+
+#include <string>
+#include <vector>
+#include <binarization/engine_autotune.h>
+#include <binarization/postprocessing.h>
+
+// Parameter aller Verfahren von -m all (Bedeutung wie bei den einzelnen Methoden)
+struct AllMethodsOptions {
+    std::string output_path;               // parallel und adaptive_median (leer = Results/)
+    int threshold = 128;                   // parallel
+    int window_size = 15;                  // advanced
+    std::vector<int> window_sizes = {15};  // integral
+    float k = 0.2f;
+    float R = 128.0f;
+    BinarizationEngine engine = BinarizationEngine::Naive;
+    std::string calibration_path = DEFAULT_CALIBRATION_PATH;
+    PostprocessOptions postprocess;
+    float max_skew = 0.0f;                 // > 0: Graustufenebene einmal geraderichten (advanced, integral)
+    bool color = false;                    // adaptive_median
+    bool impulse_map = false;              // adaptive_median
+};
+
+// parallel, advanced, integral und adaptive_median als Aufgabengraph: Bild einmal laden und einmal in
+// Graustufen umwandeln, danach laufen die Verfahren gleichzeitig; kritischer Pfad im Log und im Bericht
+void process_all_methods(const std::string &input_path, const AllMethodsOptions &options);
+
+#endif // ALL_METHODS_H
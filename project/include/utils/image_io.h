@@ -1,6 +1,8 @@
 #ifndef IMAGE_IO_H
 #define IMAGE_IO_H
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 // Bild einlesen (RGB oder Graustufen)
@@ -9,7 +11,38 @@ bool write_ppm_ascii(const std::string &filename, int width, int height, int cha
 // Graustufen-Umwandlung
 bool write_binary_image(const std::string &filename, int width, int height, int channels, const unsigned char *data);
 
-// Hilfsfunktion zur Generierung des Ausgabepfads
+// 16-Bit-Ausgabe: PNG und PGM/PPM mit 16 Bit pro Kanal, andere Formate auf 8 Bit reduziert
+bool write_image_16(const std::string &filename, int width, int height, int channels, const uint16_t *data);
+
+// true, wenn die Datei 16 Bit pro Kanal speichert (16-Bit-PNG, PGM/PPM mit maxval > 255)
+bool is_16bit_image(const std::string &path);
+
+// Abmessungen und Kanalzahl aus dem Dateikopf, ohne zu dekodieren; false, wenn nicht lesbar
+bool read_image_info(const std::string &path, int &width, int &height, int &channels);
+
+// Bild mit 8 (stbi_load) bzw. 16 Bit (stbi_load_16) pro Kanal laden; freigeben mit stbi_image_free
+// (Lade- und Schreibfunktionen erfassen ihre Dauer als Stufe "decode" bzw. "encode" im Laufzeitbericht)
+template <typename Pixel>
+Pixel *load_image(const std::string &path, int &width, int &height, int &channels);
+
+// Graustufen-Umwandlung mit Luminanzgewichten (Bilder mit weniger als 3 Kanälen: erster Kanal)
+template <typename Pixel>
+void convert_to_grayscale(const Pixel *image, int channels, Pixel *gray, size_t pixels);
+
+// Hilfsfunktion zur Generierung des Ausgabepfads (mit stdout-Ausgabe immer "-")
 std::string make_output_path(const std::string &input_path, const std::string &methodName);
 
+// "-" als Pfad: Bild von stdin lesen (PNM, PNG, JPEG, ...) bzw. nach stdout schreiben
+bool is_stdio_path(const std::string &path);
+
+// Format der Bilder auf stdout (--format); PNM als binäres PGM/PPM, mehrere Bilder hintereinander
+enum class StreamFormat { Png, Jpg, Pnm };
+bool parse_stream_format(const std::string &name, StreamFormat &format);
+const char *stream_format_name(StreamFormat format);
+void set_stream_format(StreamFormat format);
+
+// Alle Ergebnisbilder nach stdout (-o -), auch die der Verfahren, die sonst unter Results/ schreiben
+void set_stdout_output(bool enabled);
+bool stdout_output_enabled();
+
 #endif // IMAGE_IO_H
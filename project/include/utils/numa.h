@@ -0,0 +1,81 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Allokator ohne Wertinitialisierung: eine Seite wird erst beim ersten Schreiben (first touch)
+// dem NUMA-Knoten des schreibenden Threads zugeordnet, nicht beim Anlegen im Hauptthread
+template <typename T>
+struct FirstTouchAllocator : std::allocator<T> {
+    template <typename U>
+    struct rebind { using other = FirstTouchAllocator<U>; };
+
+    FirstTouchAllocator() = default;
+    template <typename U>
+    FirstTouchAllocator(const FirstTouchAllocator<U> &) noexcept {}
+
+    template <typename U>
+    void construct(U *p) noexcept(std::is_nothrow_default_constructible<U>::value) {
+        ::new (static_cast<void *>(p)) U;
+    }
+    template <typename U, typename... Args>
+    void construct(U *p, Args &&...args) {
+        ::new (static_cast<void *>(p)) U(std::forward<Args>(args)...);
+    }
+};
+
+template <typename T>
+using FirstTouchVector = std::vector<T, FirstTouchAllocator<T>>;
+
+// Setzt bytes Bytes ab data auf 0, parallel in zusammenhängenden Abschnitten wie schedule(static)
+// der Kerne, damit jede Seite auf dem Knoten des Threads liegt, der sie später bearbeitet
+void first_touch(void *data, size_t bytes);
+
+// Puffer mit count Nullelementen (Ersatz für std::vector<T>(count) bei Bildebenen)
+template <typename T>
+FirstTouchVector<T> make_first_touch_vector(size_t count) {
+    static_assert(std::is_trivial<T>::value, "first touch zeroes raw memory");
+    FirstTouchVector<T> buffer(count);
+    first_touch(buffer.data(), count * sizeof(T));
+    return buffer;
+}
+
+// Thread-Bindung: none = Vorgabe der OpenMP-Laufzeit (OMP_PROC_BIND/OMP_PLACES),
+// close = Kerne eines Sockels zuerst, spread = Threads abwechselnd auf die Sockel
+enum class ThreadBinding {
+    None,
+    Close,
+    Spread
+};
+
+bool parse_thread_binding(const std::string &name, ThreadBinding &binding);
+const char *thread_binding_name(ThreadBinding binding);
+ThreadBinding current_thread_binding();
+
+// Bindet jeden Thread des OpenMP-Pools an eine CPU (ein Thread pro physischem Kern, dann SMT);
+// false, wenn die Affinität nicht gesetzt werden konnte
+bool bind_threads(ThreadBinding binding);
+
+// Verteilung der OpenMP-Threads auf die Sockel (Momentaufnahme über sched_getcpu)
+struct SocketPlacement {
+    int socket;
+    int threads;
+    std::vector<int> cpus;
+};
+std::vector<SocketPlacement> thread_placement();
+void log_thread_placement();
+
+// Anteil der Seiten eines Puffers je NUMA-Knoten (Stichprobe); leer ohne NUMA-Information
+std::vector<int64_t> page_nodes(const void *data, size_t bytes);
+
+// Loggt die Seitenverteilung eines Puffers, nur auf Systemen mit mehreren NUMA-Knoten
+void log_page_placement(const char *name, const void *data, size_t bytes);
+
+#endif // NUMA_H
@@ -0,0 +1,34 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <cstdint>
+
+// Hardwarezähler (Linux perf_event_open) für jeden OpenMP-Thread: Zyklen, Instruktionen,
+// Last-Level-Cache-Misses und falsch vorhergesagte Sprünge; -1 = Zähler nicht verfügbar
+struct CounterSample {
+    int64_t cycles = -1;
+    int64_t instructions = -1;
+    int64_t llc_misses = -1;
+    int64_t branch_misses = -1;
+
+    bool valid() const { return cycles >= 0; }
+};
+
+// Öffnet die Zähler auf allen Threads des OpenMP-Pools (Benutzermodus). Ist das nicht erlaubt
+// (perf_event_paranoid, Container, kein Linux), wird eine Warnung geloggt und false geliefert.
+bool perf_counters_enable();
+bool perf_counters_enabled();
+
+// Zählerstände summiert über alle Threads (multiplexte Zähler hochgerechnet)
+CounterSample perf_counters_read();
+
+// end - begin; Zähler, die in einem der beiden Werte fehlen, bleiben -1
+CounterSample counter_delta(const CounterSample &begin, const CounterSample &end);
+
+// Kennzahlen einer Differenz: Instruktionen pro Zyklus, Misses pro Pixel und
+// geschätzter Speicherverkehr (ein 64-Byte-Cacheblock pro LLC-Miss); < 0 = nicht verfügbar
+double counter_ipc(const CounterSample &delta);
+double counter_per_pixel(int64_t count, int64_t pixels);
+double counter_bytes_per_pixel(const CounterSample &delta, int64_t pixels);
+
+#endif // PERF_COUNTERS_H
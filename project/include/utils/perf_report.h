@@ -0,0 +1,101 @@
+#ifndef PERF_REPORT_H
+#define PERF_REPORT_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utils/perf_counters.h>
+
+// Maschinenlesbarer Laufzeitbericht (--report run.json): pro Auftrag die Stufen
+// decode, gray, deskew, statistics, threshold, postprocess, filter, encode mit Dauer,
+// MPix/s, Threadanzahl, Spitzen-RSS, in der Stufe angeforderten Bytes und (mit --counters)
+// Hardwarezählern
+
+// Aufzeichnung einschalten (ohne Aufruf messen PerfStage-Objekte nur die Zeit)
+void perf_report_enable(const std::string &input_path, const std::string &method);
+bool perf_report_enabled();
+
+// Bericht als JSON schreiben; false bei Schreibfehler
+bool perf_report_write(const std::string &path);
+
+// Knoten eines ausgeführten Aufgabengraphen (-m all): Start und Ende in Sekunden ab Graphstart
+struct TaskGraphNodeRecord {
+    std::string name;
+    double start_seconds;
+    double end_seconds;
+    int threads;
+    bool critical;  // liegt auf dem kritischen Pfad
+};
+
+// Aufgabengraph in den Bericht übernehmen ("task_graph"); ohne aktivierten Bericht wirkungslos
+void perf_report_task_graph(const std::vector<TaskGraphNodeRecord> &nodes, double critical_path_seconds,
+                            double wall_seconds);
+
+// Während eines Aufgabengraphen überlappen Stufen verschiedener Aufträge: prozessweite Differenzen
+// (angeforderte Bytes, Hardwarezähler) sind dann keiner Stufe zuzuordnen und werden als null geschrieben
+void perf_report_set_overlapping(bool overlapping);
+
+// Spitzen-RSS des Prozesses in Bytes (0, falls vom System nicht geliefert)
+int64_t peak_rss_bytes();
+
+// Seit Programmstart angeforderte Heap-Bytes (operator new und stb-Allokationen)
+uint64_t allocated_bytes();
+
+// Zählende Allokatoren (stb_image / stb_image_write und ersetzter operator new)
+void *perf_malloc(size_t size);
+void *perf_aligned_malloc(size_t alignment, size_t size);  // size muss ein Vielfaches von alignment sein
+void *perf_realloc(void *ptr, size_t size);
+void perf_free(void *ptr);
+// Anderweitig (z. B. mit mmap) angeforderte Bytes mitzählen
+void perf_count_allocation(size_t size);
+
+// Auftrag (z. B. "advanced", "integral") des aufrufenden Threads für die Lebensdauer des Objekts;
+// alle PerfStage-Objekte dieses Threads werden ihm zugeordnet
+class PerfJob {
+public:
+    explicit PerfJob(const std::string &name);
+    ~PerfJob();
+
+    PerfJob(const PerfJob &) = delete;
+    PerfJob &operator=(const PerfJob &) = delete;
+
+private:
+    int index_;
+    int previous_;
+    const char *trace_name_;
+    int64_t trace_begin_;
+    std::chrono::high_resolution_clock::time_point start_;
+};
+
+// Misst eine Stufe vom Konstruktor bis stop() bzw. zum Destruktor (mit --trace auch als Spanne im Trace,
+// mit --counters auch Zyklen, Instruktionen und Misses aller Threads)
+class PerfStage {
+public:
+    PerfStage(const char *stage, int64_t pixels = 0, std::string detail = {});
+    ~PerfStage();
+
+    PerfStage(const PerfStage &) = delete;
+    PerfStage &operator=(const PerfStage &) = delete;
+
+    // Pixelzahl nachtragen (z. B. nach dem Dekodieren)
+    void set_pixels(int64_t pixels) { pixels_ = pixels; }
+
+    // Stufe beenden und aufzeichnen; liefert die Dauer in Sekunden (weitere Aufrufe: dieselbe Dauer)
+    double stop();
+
+private:
+    const char *stage_;
+    std::string detail_;
+    int64_t pixels_;
+    int threads_;
+    uint64_t allocated_start_;
+    bool attributable_;  // keine überlappenden Stufen seit dem Start
+    double seconds_ = -1.0;
+    int64_t trace_begin_;
+    CounterSample counters_start_;
+    std::chrono::high_resolution_clock::time_point start_;
+};
+
+#endif // PERF_REPORT_H
@@ -0,0 +1,34 @@
+#ifndef PIXEL_TRAITS_H
+#define PIXEL_TRAITS_H
+
+#include <cstdint>
+
+// Eigenschaften der unterstützten Pixeltypen (8 und 16 Bit pro Kanal)
+template <typename Pixel>
+struct PixelTraits;
+
+template <>
+struct PixelTraits<uint8_t> {
+    static constexpr int bits = 8;
+    static constexpr uint32_t max_value = 255;
+    using sum_type = uint32_t;   // Summenebene des Integralbildes (exakt modulo 2^32)
+    using accum_type = int32_t;  // Summen kleiner Fenster (8x8-Blöcke, Sobel)
+    using stat_type = float;     // Akkumulator der naiven Fensterstatistik
+};
+
+template <>
+struct PixelTraits<uint16_t> {
+    static constexpr int bits = 16;
+    static constexpr uint32_t max_value = 65535;
+    using sum_type = uint64_t;
+    using accum_type = int64_t;
+    using stat_type = double;
+};
+
+// Faktor, um 8-Bit-Parameter (Schwellwert, Sauvola-R) auf den Wertebereich von Pixel zu skalieren
+template <typename Pixel>
+constexpr float pixel_range_scale() {
+    return static_cast<float>(PixelTraits<Pixel>::max_value) / 255.0f;
+}
+
+#endif // PIXEL_TRAITS_H
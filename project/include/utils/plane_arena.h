@@ -0,0 +1,93 @@
+#ifndef PLANE_ARENA_H
+#define PLANE_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+// Speicher für Bildebenen: jeder Thread hat eine Arena, die freigegebene Blöcke behält und
+// bei der nächsten Anforderung ähnlicher Größe (bis zur doppelten Größe) wiederverwendet.
+// Blöcke sind 64-Byte-ausgerichtet und beim Wiederverwenden nicht initialisiert.
+
+// Seiten für große Blöcke: off = normale 4-KiB-Seiten, thp = transparente Huge Pages (madvise),
+// explicit = vorreservierte Huge Pages (MAP_HUGETLB, ohne Reserve Rückfall auf thp)
+enum class HugePages {
+    Off,
+    Transparent,
+    Explicit
+};
+
+bool parse_huge_pages(const std::string &name, HugePages &mode);
+const char *huge_pages_name(HugePages mode);
+void set_huge_pages(HugePages mode);  // gilt für danach neu angelegte Blöcke
+HugePages current_huge_pages();
+
+// Rohspeicher aus der Arena des aufrufenden Threads (nullptr für 0 Bytes oder bei Speichermangel);
+// kleine Anforderungen gehen direkt an den Heap. Freigabe von jedem Thread aus möglich.
+void *plane_arena_alloc(size_t bytes);
+void *plane_arena_realloc(void *ptr, size_t bytes);
+void plane_arena_free(void *ptr);
+size_t plane_arena_capacity(const void *ptr);
+
+struct PlaneArenaStats {
+    uint64_t allocations;      // neu angelegte Blöcke
+    uint64_t reuses;           // aus einer Arena wiederverwendete Blöcke
+    uint64_t reserved_bytes;   // Kapazität aller Blöcke (in Gebrauch und zwischengespeichert)
+    uint64_t huge_page_bytes;  // davon mit MAP_HUGETLB bzw. MADV_HUGEPAGE angelegt
+};
+PlaneArenaStats plane_arena_stats();
+void log_plane_arena_stats();
+
+// Bildebene aus der Arena (nur verschiebbar); Inhalt nach dem Anlegen unbestimmt
+template <typename T>
+class Plane {
+    static_assert(std::is_trivial<T>::value, "planes hold uninitialised raw memory");
+
+public:
+    Plane() = default;
+    explicit Plane(size_t count) : data_(static_cast<T *>(plane_arena_alloc(count * sizeof(T)))), size_(count) {}
+    ~Plane() { plane_arena_free(data_); }
+
+    Plane(Plane &&other) noexcept
+        : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+    Plane &operator=(Plane &&other) noexcept {
+        if (this != &other) {
+            plane_arena_free(data_);
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+        }
+        return *this;
+    }
+    Plane(const Plane &) = delete;
+    Plane &operator=(const Plane &) = delete;
+
+    // Neue Größe ohne Erhalt des Inhalts; der Block wird nur getauscht, wenn er zu klein ist
+    void reallocate(size_t count) {
+        if (count * sizeof(T) > plane_arena_capacity(data_)) {
+            plane_arena_free(data_);
+            data_ = static_cast<T *>(plane_arena_alloc(count * sizeof(T)));
+        }
+        size_ = count;
+    }
+
+    T *data() { return data_; }
+    const T *data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    T &operator[](size_t i) { return data_[i]; }
+    const T &operator[](size_t i) const { return data_[i]; }
+
+    T *begin() { return data_; }
+    T *end() { return data_ + size_; }
+    const T *begin() const { return data_; }
+    const T *end() const { return data_ + size_; }
+
+private:
+    T *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+#endif // PLANE_ARENA_H
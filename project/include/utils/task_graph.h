@@ -0,0 +1,74 @@
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Abhängigkeitsgraph von Aufgaben auf einem gemeinsamen OpenMP-Pool: ein Knoten startet als
+// OpenMP-Task, sobald alle Vorgänger fertig sind. Parallele Regionen in den Knoten laufen
+// verschachtelt und teilen sich die Threads mit den gleichzeitig bereiten Knoten; der Anteil
+// wird beim Start eines Knotens und bei jedem Aufruf von task_graph_rebalance neu bestimmt.
+class TaskGraph {
+public:
+    // Knoten anlegen; deps sind Indizes bereits angelegter Knoten. Liefert den Index des Knotens.
+    int add(const std::string &name, std::function<void()> work, const std::vector<int> &deps = {});
+
+    // Alle Knoten ausführen (jeder als PerfJob seines Namens) und Zeiten sowie kritischen Pfad loggen
+    void run();
+
+    // Zeiten des letzten Laufs in Sekunden ab Start von run()
+    struct NodeTiming {
+        double start = 0.0;
+        double end = 0.0;
+        int threads = 0;  // größte Threadzahl der parallelen Regionen im Knoten
+    };
+    const std::vector<NodeTiming> &timings() const { return timings_; }
+    const std::string &name(int node) const { return nodes_[node].name; }
+    size_t size() const { return nodes_.size(); }
+    double wall_seconds() const { return wall_seconds_; }
+
+    // Längste Kette gemessener Knotendauern entlang der Abhängigkeiten (Knoten in Ausführungsreihenfolge)
+    std::vector<int> critical_path() const;
+    double critical_path_seconds() const;
+
+    // Zustand eines Laufs (in task_graph.cpp definiert)
+    struct RunState;
+
+private:
+    struct Node {
+        std::string name;
+        std::function<void()> work;
+        std::vector<int> deps;
+        std::vector<int> successors;
+    };
+
+    void launch(int node, RunState &state);
+
+    std::vector<Node> nodes_;
+    std::vector<NodeTiming> timings_;
+    double wall_seconds_ = 0.0;
+};
+
+// Threadzahl der folgenden parallelen Regionen des laufenden Knotens auf seinen aktuellen Anteil am Pool
+// setzen (Pool / bereite und laufende Knoten, der Rest an die am längsten laufenden). Von Knoten mit
+// mehreren Stufen dazwischen aufgerufen, so übernimmt ein Knoten die Threads fertiger Knoten. Außerhalb
+// eines Graphen wirkungslos.
+void task_graph_rebalance();
+
+// Obergrenze der Threadzahl bis zum Ende des Gültigkeitsbereichs: im Knoten eines Graphen für seinen
+// Anteil am Pool, sonst wie omp_set_num_threads (danach wiederhergestellt)
+class ThreadLimit {
+public:
+    explicit ThreadLimit(int threads);
+    ~ThreadLimit();
+
+    ThreadLimit(const ThreadLimit &) = delete;
+    ThreadLimit &operator=(const ThreadLimit &) = delete;
+
+private:
+    int previous_threads_;
+    int previous_limit_;
+};
+
+#endif // TASK_GRAPH_H
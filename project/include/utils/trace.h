@@ -0,0 +1,50 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Optionale Ablaufverfolgung (--trace trace.json): Spannen pro Thread, auch innerhalb
+// von OpenMP-Regionen, Export im Chrome-Trace-Format (chrome://tracing, ui.perfetto.dev)
+
+// Aufzeichnung einschalten; der aufrufende Thread erscheint im Trace als "main"
+void trace_enable();
+
+// Alle bisher aufgezeichneten Spannen als Chrome-Trace-JSON schreiben; false bei Schreibfehler
+bool trace_write_chrome(const std::string &path);
+
+namespace trace_detail {
+extern std::atomic<bool> enabled;
+int64_t now_ns();
+// Hängt eine Spanne an den Puffer des aufrufenden Threads an (ohne Sperre)
+void record(const char *name, const char *category, int64_t begin_ns, int64_t end_ns);
+// Dauerhafte Kopie eines zur Laufzeit gebildeten Namens (z. B. Auftragsname)
+const char *intern(const std::string &name);
+}
+
+inline bool trace_enabled() {
+    return trace_detail::enabled.load(std::memory_order_relaxed);
+}
+
+// Spanne vom Konstruktor bis zum Destruktor; name und category müssen Literale sein (werden nicht kopiert).
+// Ohne trace_enable() kostet ein Objekt nur das Lesen eines Flags.
+class TraceSpan {
+public:
+    explicit TraceSpan(const char *name, const char *category = "kernel")
+        : name_(name), category_(category), begin_(trace_enabled() ? trace_detail::now_ns() : -1) {}
+
+    ~TraceSpan() {
+        if (begin_ >= 0) trace_detail::record(name_, category_, begin_, trace_detail::now_ns());
+    }
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+    const char *name_;
+    const char *category_;
+    int64_t begin_;
+};
+
+#endif // TRACE_H
@@ -0,0 +1,468 @@
+#include <binarization/thresholding.h>
+#include <binarization/adaptive_thresholding.h>
+#include <binarization/integral_binarization.h>
+#include <binarization/integral_image.h>
+#include <filters/adaptive_median_filter.h>
+#include <utils/image_io.h>
+#include <utils/numa.h>
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <omp.h>
+#include <stb_image.h>
+#include <spdlog/spdlog.h>
+
+// Micro-benchmarks of the individual kernels, without image I/O. Every kernel runs
+// on in-memory buffers for each (image size, window size, thread count); the
+// results go to a CSV file (one row per measurement) and a JSON file.
+
+struct BenchConfig {
+    std::vector<std::pair<int, int>> sizes = {{512, 512}, {1024, 1024}, {2048, 2048}};
+    std::vector<int> windows = {15, 31, 61};
+    std::vector<int> threads;  // default: 1, 2, 4, ... up to omp_get_max_threads()
+    std::vector<std::string> kernels;  // empty = all
+    int warmup = 1;
+    int repetitions = 5;
+    double naive_budget = 2e9;  // largest width * height * window^2 for the naive kernels
+    std::string input_path;     // optional real image instead of the synthetic page
+    ThreadBinding binding = ThreadBinding::None;
+    std::string csv_path = "benchmark_results.csv";
+    std::string json_path = "benchmark_results.json";
+};
+
+// Images of one size, shared by all kernels. The source is generated serially;
+// the planes the kernels work on are re-created for every thread count so that
+// first touch places their pages with the team that runs the kernels.
+struct BenchImages {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> source;
+    FirstTouchVector<unsigned char> rgb;
+    FirstTouchVector<unsigned char> gray;
+    FirstTouchVector<unsigned char> out;
+    FirstTouchVector<unsigned char> median_out;
+    IntegralImage integral;
+};
+
+struct BenchResult {
+    std::string kernel;
+    int width, height, window, threads, repetitions;
+    double min_seconds, median_seconds, mean_seconds;
+
+    double mpix_per_second() const {
+        return median_seconds > 0.0 ? (static_cast<double>(width) * height / 1e6) / median_seconds : 0.0;
+    }
+};
+
+// One kernel under test; window-independent kernels run once per size and thread count
+struct Kernel {
+    std::string name;
+    bool uses_window;
+    bool naive;  // cost grows with window^2, limited by naive_budget
+    std::function<void(BenchImages &, int)> run;
+};
+
+/**
+ * Small xorshift generator so every run benchmarks the same pixels.
+ */
+class XorShift32 {
+public:
+    explicit XorShift32(uint32_t seed) : state_(seed ? seed : 1u) {}
+    uint32_t operator()() {
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 17;
+        state_ ^= state_ << 5;
+        return state_;
+    }
+private:
+    uint32_t state_;
+};
+
+/**
+ * Fills images with a synthetic scanned page: an uneven background, lines of dark
+ * glyph-like blocks, Gaussian-ish noise and 1% salt-and-pepper impulses.
+ *
+ * @param images Target; width and height must be set.
+ */
+void make_synthetic_page(BenchImages &images) {
+    const int width = images.width, height = images.height;
+    images.source.resize(static_cast<size_t>(width) * height * 3);
+    XorShift32 rng(static_cast<uint32_t>(width * 7919 + height));
+
+    const int line_height = std::max(8, height / 40);
+    const int glyph_width = std::max(4, line_height / 2);
+
+    for (int y = 0; y < height; ++y) {
+        const int line_y = y % (2 * line_height);
+        for (int x = 0; x < width; ++x) {
+            int value = 170 + 60 * x / std::max(1, width) - 20 * y / std::max(1, height);
+            const int glyph = x / glyph_width;
+            const bool in_line = line_y >= line_height / 2 && line_y < line_height + line_height / 2;
+            const bool in_glyph = (x % glyph_width) < glyph_width - 2 && ((glyph * 2654435761u) >> 28) % 4 != 0;
+            if (in_line && in_glyph) value = 40;
+
+            const uint32_t r = rng();
+            value += static_cast<int>(r & 15) + static_cast<int>((r >> 4) & 15) - 15;
+            const uint32_t impulse = (r >> 8) % 200;
+            if (impulse == 0) value = 0;
+            if (impulse == 1) value = 255;
+
+            const size_t idx = (static_cast<size_t>(y) * width + x) * 3;
+            const unsigned char v = static_cast<unsigned char>(std::clamp(value, 0, 255));
+            images.source[idx] = v;
+            images.source[idx + 1] = v;
+            images.source[idx + 2] = v;
+        }
+    }
+}
+
+/**
+ * Prepares the RGB copy, gray plane, output buffers and integral image of one
+ * size with the current thread count.
+ */
+void prepare_images(BenchImages &images) {
+    const size_t pixels = static_cast<size_t>(images.width) * images.height;
+    images.rgb = make_first_touch_vector<unsigned char>(pixels * 3);
+    unsigned char *rgb = images.rgb.data();
+    const unsigned char *source = images.source.data();
+    #pragma omp parallel for simd
+    for (size_t i = 0; i < pixels * 3; ++i) rgb[i] = source[i];
+
+    images.gray = make_first_touch_vector<unsigned char>(pixels);
+    images.out = make_first_touch_vector<unsigned char>(pixels * 3);
+    images.median_out = make_first_touch_vector<unsigned char>(pixels);
+    convert_to_grayscale(images.rgb.data(), 3, images.gray.data(), pixels);
+    images.integral = IntegralImage();
+    images.integral.build(images.gray.data(), images.width, images.height);
+}
+
+/**
+ * Loads a real image as benchmark input (converted to RGB).
+ *
+ * @return false if the image could not be loaded.
+ */
+bool load_input_image(const std::string &path, BenchImages &images) {
+    int channels;
+    unsigned char *image = stbi_load(path.c_str(), &images.width, &images.height, &channels, 3);
+    if (!image) {
+        return false;
+    }
+    images.source.assign(image, image + static_cast<size_t>(images.width) * images.height * 3);
+    stbi_image_free(image);
+    return true;
+}
+
+std::vector<Kernel> make_kernels() {
+    const float k = 0.2f, R = 128.0f;
+    return {
+        {"GrayConversion", false, false, [](BenchImages &img, int) {
+            convert_to_grayscale(img.rgb.data(), 3, img.out.data(), img.gray.size());
+        }},
+        {"GlobalThreshold", false, false, [](BenchImages &img, int) {
+            binarize_pixels(img.rgb.data(), img.out.data(), img.width * img.height, 3, 128, false);
+        }},
+        {"GlobalThresholdParallel", false, false, [](BenchImages &img, int) {
+            binarize_pixels(img.rgb.data(), img.out.data(), img.width * img.height, 3, 128, true);
+        }},
+        {"IntegralBuild", false, false, [](BenchImages &img, int) {
+            img.integral.build(img.gray.data(), img.width, img.height);
+        }},
+        {"NaiveSauvola", true, true, [k, R](BenchImages &img, int window) {
+            sauvola_binarize(img.gray.data(), img.out.data(), img.width, img.height, window, k, R);
+        }},
+        {"NaiveNick", true, true, [k](BenchImages &img, int window) {
+            nick_binarize(img.gray.data(), img.out.data(), img.width, img.height, window, k);
+        }},
+        {"IntegralSauvola", true, false, [k, R](BenchImages &img, int window) {
+            sauvola_binarize_integral(img.integral, img.gray.data(), img.out.data(), window, k, R);
+        }},
+        {"IntegralNick", true, false, [k](BenchImages &img, int window) {
+            nick_binarize_integral(img.integral, img.gray.data(), img.out.data(), window, k);
+        }},
+        {"AdaptiveMedian", true, false, [](BenchImages &img, int window) {
+            adaptive_median_filter_process(img.gray.data(), img.median_out.data(), img.width, img.height, 1, 3, window);
+        }},
+    };
+}
+
+/**
+ * Runs a kernel `warmup` times untimed, then `repetitions` times timed.
+ *
+ * @return Wall-clock seconds of every timed run.
+ */
+std::vector<double> time_kernel(const Kernel &kernel, BenchImages &images, int window,
+                                int warmup, int repetitions) {
+    for (int i = 0; i < warmup; ++i) {
+        kernel.run(images, window);
+    }
+    std::vector<double> times;
+    times.reserve(repetitions);
+    for (int i = 0; i < repetitions; ++i) {
+        double start = omp_get_wtime();
+        kernel.run(images, window);
+        double end = omp_get_wtime();
+        times.push_back(end - start);
+    }
+    return times;
+}
+
+BenchResult summarize(const std::string &name, const BenchImages &images, int window, int threads,
+                      std::vector<double> times) {
+    std::sort(times.begin(), times.end());
+    const size_t n = times.size();
+    const double median = n % 2 ? times[n / 2] : 0.5 * (times[n / 2 - 1] + times[n / 2]);
+    const double mean = std::accumulate(times.begin(), times.end(), 0.0) / n;
+    return {name, images.width, images.height, window, threads, static_cast<int>(n), times.front(), median, mean};
+}
+
+/**
+ * Benchmarks every selected kernel over the size, window and thread matrix.
+ *
+ * @param config Matrix, repetitions and kernel selection.
+ * @return One result per measurement.
+ */
+std::vector<BenchResult> benchmark_kernels(const BenchConfig &config) {
+    std::vector<BenchResult> results;
+    const std::vector<Kernel> kernels = make_kernels();
+
+    auto selected = [&](const Kernel &kernel) {
+        return config.kernels.empty() ||
+               std::find(config.kernels.begin(), config.kernels.end(), kernel.name) != config.kernels.end();
+    };
+
+    // Loop over different image sizes to benchmark
+    for (const auto &[width, height] : config.sizes) {
+        BenchImages images;
+        if (!config.input_path.empty()) {
+            if (!load_input_image(config.input_path, images)) {
+                std::cerr << "Failed to load image: " << config.input_path << std::endl;
+                return results;
+            }
+        } else {
+            images.width = width;
+            images.height = height;
+            make_synthetic_page(images);
+        }
+
+        // Loop over different numbers of threads for parallel benchmarking
+        for (int num_threads : config.threads) {
+            omp_set_num_threads(num_threads);
+            prepare_images(images);
+
+            for (const Kernel &kernel : kernels) {
+                if (!selected(kernel)) continue;
+
+                const std::vector<int> windows = kernel.uses_window ? config.windows : std::vector<int>{0};
+                for (int window : windows) {
+                    const double cost = static_cast<double>(images.width) * images.height * window * window;
+                    if (kernel.naive && cost > config.naive_budget) {
+                        std::cout << "  skip " << kernel.name << " " << images.width << "x" << images.height
+                                  << " w=" << window << " (exceeds --naive_budget)" << std::endl;
+                        continue;
+                    }
+
+                    BenchResult result = summarize(kernel.name, images, window, num_threads,
+                                                   time_kernel(kernel, images, window, config.warmup, config.repetitions));
+                    std::cout << "  " << std::left << std::setw(24) << result.kernel << std::right
+                              << std::setw(6) << result.width << "x" << std::setw(5) << result.height
+                              << "  w=" << std::setw(3) << result.window
+                              << "  threads=" << std::setw(2) << result.threads
+                              << "  median " << std::fixed << std::setprecision(5) << result.median_seconds << " s"
+                              << "  " << std::setprecision(1) << result.mpix_per_second() << " MPix/s"
+                              << std::defaultfloat << std::endl;
+                    results.push_back(result);
+                }
+            }
+        }
+
+        // A real input image has one size only
+        if (!config.input_path.empty()) break;
+    }
+    return results;
+}
+
+bool write_csv(const std::string &path, const std::vector<BenchResult> &results) {
+    std::ofstream result_file(path);
+    if (!result_file) return false;
+    result_file << "Kernel,Width,Height,WindowSize,NumThreads,Repetitions,"
+                   "MinSeconds,MedianSeconds,MeanSeconds,MPixPerSecond" << std::endl;
+    for (const BenchResult &r : results) {
+        result_file << r.kernel << "," << r.width << "," << r.height << "," << r.window << ","
+                    << r.threads << "," << r.repetitions << "," << r.min_seconds << ","
+                    << r.median_seconds << "," << r.mean_seconds << "," << r.mpix_per_second() << std::endl;
+    }
+    return true;
+}
+
+bool write_json(const std::string &path, const BenchConfig &config, const std::vector<BenchResult> &results) {
+    std::ofstream json(path);
+    if (!json) return false;
+    json << "{\n  \"processors\": " << omp_get_num_procs()
+         << ",\n  \"max_threads\": " << omp_get_max_threads()
+         << ",\n  \"binding\": \"" << thread_binding_name(current_thread_binding()) << "\""
+         << ",\n  \"warmup\": " << config.warmup
+         << ",\n  \"repetitions\": " << config.repetitions
+         << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult &r = results[i];
+        json << "    {\"kernel\": \"" << r.kernel << "\", \"width\": " << r.width << ", \"height\": " << r.height
+             << ", \"window_size\": " << r.window << ", \"threads\": " << r.threads
+             << ", \"repetitions\": " << r.repetitions << ", \"min_seconds\": " << r.min_seconds
+             << ", \"median_seconds\": " << r.median_seconds << ", \"mean_seconds\": " << r.mean_seconds
+             << ", \"mpix_per_second\": " << r.mpix_per_second() << "}"
+             << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    json << "  ]\n}\n";
+    return true;
+}
+
+// Parses a comma-separated list of positive integers, e.g. "1,2,4"
+std::vector<int> parse_int_list(const std::string &value) {
+    std::vector<int> list;
+    std::stringstream ss(value);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        int v = std::stoi(item);
+        if (v <= 0) {
+            throw std::invalid_argument("values must be positive");
+        }
+        list.push_back(v);
+    }
+    if (list.empty()) {
+        throw std::invalid_argument("empty list");
+    }
+    return list;
+}
+
+// Parses image sizes such as "1024,1920x1080" (N = N x N)
+std::vector<std::pair<int, int>> parse_sizes(const std::string &value) {
+    std::vector<std::pair<int, int>> sizes;
+    std::stringstream ss(value);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        const size_t x = item.find('x');
+        const int w = std::stoi(item.substr(0, x));
+        const int h = x == std::string::npos ? w : std::stoi(item.substr(x + 1));
+        if (w <= 0 || h <= 0) {
+            throw std::invalid_argument("sizes must be positive");
+        }
+        sizes.emplace_back(w, h);
+    }
+    if (sizes.empty()) {
+        throw std::invalid_argument("empty size list");
+    }
+    return sizes;
+}
+
+std::vector<std::string> parse_name_list(const std::string &value) {
+    std::vector<std::string> names;
+    std::stringstream ss(value);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) names.push_back(item);
+    }
+    return names;
+}
+
+void printHelp() {
+    std::cout << "Usage: bench_image_processor [options]\n"
+              << "Options:\n"
+              << "  --sizes <list>          Image sizes, e.g. 512,1024,1920x1080 (default: 512,1024,2048)\n"
+              << "  --windows <list>        Window sizes for Sauvola/Nick/median (default: 15,31,61)\n"
+              << "  --threads <list>        Thread counts (default: 1,2,4,... up to all cores)\n"
+              << "  --kernels <list>        Kernels to run (default: all):\n"
+              << "                          GrayConversion, GlobalThreshold, GlobalThresholdParallel,\n"
+              << "                          IntegralBuild, NaiveSauvola, NaiveNick, IntegralSauvola,\n"
+              << "                          IntegralNick, AdaptiveMedian\n"
+              << "  --warmup <num>          Untimed runs before measuring (default: 1)\n"
+              << "  --repetitions <num>     Timed runs per measurement (default: 5)\n"
+              << "  --naive_budget <num>    Skip naive kernels above width*height*window^2 (default: 2e9)\n"
+              << "  -i, --input <path>      Benchmark a real image instead of the synthetic page\n"
+              << "  --bind <policy>         Pin threads: none, close (fill one socket first), spread (default: none)\n"
+              << "  --csv <path>            CSV output (default: benchmark_results.csv)\n"
+              << "  --json <path>           JSON output (default: benchmark_results.json)\n"
+              << "  -h, --help              Show this help message\n";
+}
+
+int main(int argc, char *argv[]) {
+    BenchConfig config;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "-h" || arg == "--help") {
+                printHelp();
+                return 0;
+            }
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << std::endl;
+                return 1;
+            }
+            std::string value = argv[++i];
+            if (arg == "--sizes") config.sizes = parse_sizes(value);
+            else if (arg == "--windows") config.windows = parse_int_list(value);
+            else if (arg == "--threads") config.threads = parse_int_list(value);
+            else if (arg == "--kernels") config.kernels = parse_name_list(value);
+            else if (arg == "--warmup") config.warmup = std::max(0, std::stoi(value));
+            else if (arg == "--repetitions") config.repetitions = std::max(1, std::stoi(value));
+            else if (arg == "--naive_budget") config.naive_budget = std::stod(value);
+            else if (arg == "-i" || arg == "--input") config.input_path = value;
+            else if (arg == "--bind") {
+                if (!parse_thread_binding(value, config.binding)) throw std::invalid_argument("unknown binding " + value);
+            }
+            else if (arg == "--csv") config.csv_path = value;
+            else if (arg == "--json") config.json_path = value;
+            else {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                printHelp();
+                return 1;
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Invalid argument: " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (config.threads.empty()) {
+        const int max_threads = omp_get_max_threads();
+        for (int t = 1; t < max_threads; t *= 2) config.threads.push_back(t);
+        config.threads.push_back(max_threads);
+    }
+
+    // The kernels log every call; keep that out of the measurements
+    spdlog::set_level(spdlog::level::warn);
+
+    // Pin the whole pool once; smaller teams reuse the first threads and their CPUs
+    bind_threads(config.binding);
+
+    std::cout << "Benchmarking Environment:\n";
+    std::cout << "Processors: " << omp_get_num_procs() << "\n";
+    std::cout << "Max OpenMP threads: " << omp_get_max_threads() << "\n";
+    std::cout << "Thread binding: " << thread_binding_name(current_thread_binding()) << "\n";
+    for (const SocketPlacement &placement : thread_placement()) {
+        std::cout << "Socket " << placement.socket << ": " << placement.threads << " thread(s)\n";
+    }
+    std::cout << "Warmup runs: " << config.warmup << ", timed runs: " << config.repetitions << "\n\n";
+
+    const std::vector<BenchResult> results = benchmark_kernels(config);
+
+    if (!write_csv(config.csv_path, results)) {
+        std::cerr << "Failed to write " << config.csv_path << std::endl;
+        return 1;
+    }
+    if (!write_json(config.json_path, config, results)) {
+        std::cerr << "Failed to write " << config.json_path << std::endl;
+        return 1;
+    }
+
+    std::cout << "\nResults written to " << config.csv_path << " and " << config.json_path << std::endl;
+    return 0;
+}
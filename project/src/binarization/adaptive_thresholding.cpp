@@ -1,5 +1,14 @@
 #include <binarization/adaptive_thresholding.h>
+#include <binarization/integral_binarization.h>
+#include <binarization/integral_image.h>
+#include <binarization/deskew.h>
 #include <utils/image_io.h>
+#include <utils/numa.h>
+#include <utils/plane_arena.h>
+#include <utils/perf_report.h>
+#include <utils/pixel_traits.h>
+#include <utils/task_graph.h>
+#include <utils/trace.h>
 #include <iostream>
 #include <fstream>
 #include <filesystem>
@@ -22,14 +31,17 @@
  * @param mean Reference variable to store the computed mean.
  * @param stddev Reference variable to store the computed standard deviation.
  */
-void local_mean_std(const unsigned char* gray,
+template <typename Pixel>
+void local_mean_std(const Pixel* gray,
                     int width, int height,
                     int x, int y,
                     int half_win,
                     float &mean, float &stddev)
 {
+    // float for 8-bit images as before, double for the larger squares of 16-bit images
+    using stat_type = typename PixelTraits<Pixel>::stat_type;
     int count = 0;
-    float sum = 0.0f, sum_sq = 0.0f;
+    stat_type sum = 0, sum_sq = 0;
 
     // Iterate over the window centered at (x, y)
     for (int dy = -half_win; dy <= half_win; dy++) {
@@ -39,7 +51,7 @@ void local_mean_std(const unsigned char* gray,
 
             // Ensure the indices are within image boundaries
             if (xx >= 0 && yy >= 0 && xx < width && yy < height) {
-                unsigned char val = gray[yy * width + xx];
+                const stat_type val = gray[yy * width + xx];
                 sum += val;
                 sum_sq += val * val;
                 count++;
@@ -48,11 +60,12 @@ void local_mean_std(const unsigned char* gray,
     }
 
     // Compute the mean
-    mean = sum / count;
+    const stat_type local_mean = sum / count;
+    mean = static_cast<float>(local_mean);
 
     // Compute variance and standard deviation
-    float var = (sum_sq / count) - (mean * mean);
-    stddev = (var > 0) ? std::sqrt(var) : 0.0f;
+    const stat_type var = (sum_sq / count) - (local_mean * local_mean);
+    stddev = (var > 0) ? static_cast<float>(std::sqrt(var)) : 0.0f;
 }
 
 /**
@@ -65,37 +78,44 @@ void local_mean_std(const unsigned char* gray,
  * @param window_size Size of the local window for threshold calculation.
  * @param threshold_func Lambda function to calculate threshold based on mean and standard deviation.
  */
-void adaptive_binarize(const unsigned char* gray,
+template <typename Pixel>
+void adaptive_binarize(const Pixel* gray,
                        unsigned char* out,
                        int width, int height,
                        int window_size,
                        const std::function<float(float mean, float stddev)> &threshold_func) {
     int half_win = window_size / 2;
 
-    spdlog::info("Starting adaptive binarization with window size {}");
+    SPDLOG_DEBUG("Starting adaptive binarization with window size {}", window_size);
 
     auto start = std::chrono::high_resolution_clock::now();
 
-    // Parallelized loop to process each pixel in the image
-    #pragma omp parallel for collapse(2)
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            float mean = 0.0f, stddev = 0.0f;
+    // Parallelized loop to process each pixel in the image; nowait so that the
+    // trace span of each thread ends with its own share of the work
+    #pragma omp parallel
+    {
+        TraceSpan span("adaptive_binarize");
 
-            // Compute local mean and standard deviation
-            local_mean_std(gray, width, height, x, y, half_win, mean, stddev);
+        #pragma omp for collapse(2) nowait
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                float mean = 0.0f, stddev = 0.0f;
 
-            // Compute the adaptive threshold
-            float threshold = threshold_func(mean, stddev);
+                // Compute local mean and standard deviation
+                local_mean_std(gray, width, height, x, y, half_win, mean, stddev);
 
-            // Apply thresholding
-            out[y * width + x] = (gray[y * width + x] > threshold) ? 255 : 0;
+                // Compute the adaptive threshold
+                float threshold = threshold_func(mean, stddev);
+
+                // Apply thresholding
+                out[y * width + x] = (gray[y * width + x] > threshold) ? 255 : 0;
+            }
         }
     }
 
     auto end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<float> duration = end - start;
-    spdlog::info("Adaptive binarization completed in {} seconds.", duration.count());
+    SPDLOG_DEBUG("Adaptive binarization completed in {} seconds.", duration.count());
 }
 
 /**
@@ -107,15 +127,16 @@ void adaptive_binarize(const unsigned char* gray,
  * @param height Image height.
  * @param window_size Size of the local window for threshold calculation.
  * @param k Parameter that adjusts the thresholding sensitivity.
- * @param R Dynamic range of standard deviation (typically 128 for 8-bit images).
+ * @param R Dynamic range of standard deviation (typically 128 for 8-bit images, 128 * 257 for 16-bit images).
  */
-void sauvola_binarize(const unsigned char* gray,
-                      unsigned char* out,
-                      int width, int height,
-                      int window_size,
-                      float k,
-                      float R) {
-    spdlog::info("Starting Sauvola binarization with window size {}, k={}, R={}.", window_size, k, R);
+template <typename Pixel>
+static void sauvola_binarize_impl(const Pixel* gray,
+                                  unsigned char* out,
+                                  int width, int height,
+                                  int window_size,
+                                  float k,
+                                  float R) {
+    SPDLOG_DEBUG("Starting Sauvola binarization with window size {}, k={}, R={}.", window_size, k, R);
 
     // Define the threshold function for Sauvola
     auto threshold_func = [k, R](float mean, float stddev) {
@@ -124,7 +145,7 @@ void sauvola_binarize(const unsigned char* gray,
 
     adaptive_binarize(gray, out, width, height, window_size, threshold_func);
 
-    spdlog::info("Sauvola binarization completed.");
+    SPDLOG_DEBUG("Sauvola binarization completed.");
 }
 
 /**
@@ -137,12 +158,13 @@ void sauvola_binarize(const unsigned char* gray,
  * @param window_size Size of the local window for threshold calculation.
  * @param k Parameter that adjusts the thresholding sensitivity.
  */
-void nick_binarize(const unsigned char* gray,
-                   unsigned char* out,
-                   int width, int height,
-                   int window_size,
-                   float k) {
-    spdlog::info("Starting Nick binarization with window size {}, k={}.", window_size, k);
+template <typename Pixel>
+static void nick_binarize_impl(const Pixel* gray,
+                               unsigned char* out,
+                               int width, int height,
+                               int window_size,
+                               float k) {
+    SPDLOG_DEBUG("Starting Nick binarization with window size {}, k={}.", window_size, k);
 
     // Define the threshold function for Nick's method
     auto threshold_func = [k](float mean, float stddev) {
@@ -151,70 +173,203 @@ void nick_binarize(const unsigned char* gray,
 
     adaptive_binarize(gray, out, width, height, window_size, threshold_func);
 
-    spdlog::info("Nick binarization completed.");
+    SPDLOG_DEBUG("Nick binarization completed.");
+}
+
+void sauvola_binarize(const unsigned char* gray, unsigned char* out, int width, int height,
+                      int window_size, float k, float R) {
+    sauvola_binarize_impl(gray, out, width, height, window_size, k, R);
+}
+
+void sauvola_binarize(const uint16_t* gray, unsigned char* out, int width, int height,
+                      int window_size, float k, float R) {
+    sauvola_binarize_impl(gray, out, width, height, window_size, k, R);
+}
+
+void nick_binarize(const unsigned char* gray, unsigned char* out, int width, int height,
+                   int window_size, float k) {
+    nick_binarize_impl(gray, out, width, height, window_size, k);
+}
+
+void nick_binarize(const uint16_t* gray, unsigned char* out, int width, int height,
+                   int window_size, float k) {
+    nick_binarize_impl(gray, out, width, height, window_size, k);
 }
 
 /**
- * Loads an image, converts it to grayscale, applies Sauvola and Nick binarization,
- * and saves the results.
+ * Applies Sauvola or Nick binarization to a grayscale plane and saves the
+ * result. R is given in 8-bit units and scaled to the pixel range.
  *
- * @param input_path Path to the input image file.
- * @param window_size Size of the local window for threshold calculation.
- * @param k Parameter for thresholding.
- * @param R Dynamic range parameter for Sauvola's method.
+ * @param input_path Path of the image, used for the output path.
+ * @param gray Grayscale plane (already deskewed if requested); only read.
+ * @param integral Integral image of gray, or nullptr for the naive engine.
+ * @return Thresholding time in seconds (post-processing and writing excluded).
  */
+template <typename Pixel>
+double adaptive_method_gray(const std::string &input_path, AdaptiveMethod method, const Pixel *gray,
+                            int width, int height, const BasicIntegralImage<Pixel> *integral,
+                            int window_size, float k, float R, const PostprocessOptions &postprocess) {
+    const int64_t pixels = static_cast<int64_t>(width) * height;
+    const bool sauvola = method == AdaptiveMethod::Sauvola;
+    const char *name = sauvola ? "Sauvola" : "Nick";
+    const std::string output_path = make_output_path(input_path, sauvola ? "sauvola" : "nick");
+    const float range_R = R * pixel_range_scale<Pixel>();
+
+    // The naive engine computes the window statistics inside the threshold pass
+    const std::string detail = std::string(sauvola ? "sauvola " : "nick ")
+                             + (integral ? "integral" : "naive, includes window statistics");
+
+    Plane<unsigned char> output(pixels);
+    double seconds;
+    {
+        PerfStage stage("threshold", pixels, detail);
+        if (sauvola && integral) {
+            sauvola_binarize_integral(*integral, gray, output.data(), window_size, k, range_R);
+        } else if (sauvola) {
+            sauvola_binarize(gray, output.data(), width, height, window_size, k, range_R);
+        } else if (integral) {
+            nick_binarize_integral(*integral, gray, output.data(), window_size, k);
+        } else {
+            nick_binarize(gray, output.data(), width, height, window_size, k);
+        }
+        seconds = stage.stop();
+    }
+    postprocess_binary(output.data(), width, height, postprocess, output_path);
 
-void process_advanced_binarization(const std::string &input_path, int window_size, float k, float R) {
-    spdlog::info("Processing advanced binarization for: {} with window size {}, k={}, R={}", input_path, window_size, k, R);
+    if (!write_binary_image(output_path, width, height, 1, output.data())) {
+        spdlog::error("Failed to write {} output image: {}", name, output_path);
+    } else {
+        spdlog::info("{} binarized image saved to: {}", name, output_path);
+    }
+    return seconds;
+}
 
-    int width, height, channels;
+template double adaptive_method_gray<uint8_t>(const std::string &, AdaptiveMethod, const uint8_t *, int, int,
+                                              const IntegralImage *, int, float, float, const PostprocessOptions &);
+template double adaptive_method_gray<uint16_t>(const std::string &, AdaptiveMethod, const uint16_t *, int, int,
+                                               const IntegralImage16 *, int, float, float, const PostprocessOptions &);
 
-    // Load the image
-    unsigned char *image = stbi_load(input_path.c_str(), &width, &height, &channels, 0);
-    if (!image) {
-        spdlog::error("Failed to load image: {}", input_path);
-        return;
+/**
+ * Applies Sauvola and Nick binarization to a grayscale plane and saves the
+ * results. 16-bit planes keep their full precision; R is given in 8-bit units
+ * and scaled to the pixel range.
+ *
+ * @param input_path Path of the image, used for the output paths.
+ * @param gray Grayscale plane (already deskewed if requested); only read.
+ * @param choice Resolved engine and thread count (see choose_engine).
+ */
+template <typename Pixel>
+void advanced_binarization_gray(const std::string &input_path, const Pixel *gray, int width, int height,
+                                int window_size, float k, float R, const EngineChoice &choice,
+                                const PostprocessOptions &postprocess) {
+    const int64_t pixels = static_cast<int64_t>(width) * height;
+
+    // Auto may have lowered the thread count (in a task graph: cap of the node's share)
+    ThreadLimit thread_limit(choice.threads);
+
+    const bool use_integral = choice.engine == BinarizationEngine::Integral;
+    double compute_seconds = 0.0;
+
+    BasicIntegralImage<Pixel> integral;
+    if (use_integral) {
+        PerfStage stage("statistics", pixels, "integral image");
+        integral.build(gray, width, height);
+        compute_seconds += stage.stop();
     }
+    const BasicIntegralImage<Pixel> *statistics = use_integral ? &integral : nullptr;
 
-    // Convert to grayscale
-    std::vector<unsigned char> gray(width * height);
-    #pragma omp parallel for
-    for (int i = 0; i < width * height; i++) {
-        gray[i] = static_cast<unsigned char>(
-                0.2126f * image[i * channels + 0] +
-                0.7152f * image[i * channels + 1] +
-                0.0722f * image[i * channels + 2]);
-    }
+    compute_seconds += adaptive_method_gray(input_path, AdaptiveMethod::Sauvola, gray, width, height, statistics,
+                                            window_size, k, R, postprocess);
+    compute_seconds += adaptive_method_gray(input_path, AdaptiveMethod::Nick, gray, width, height, statistics,
+                                            window_size, k, R, postprocess);
 
-    // Generate output file paths
-    std::string output_path_sauvola = make_output_path(input_path, "sauvola");
-    std::string output_path_nick = make_output_path(input_path, "nick");
+    // Statistics and thresholding only; decoding, post-processing and writing are separate stages
+    spdlog::info("Advanced binarization process completed in {} seconds.", compute_seconds);
+}
 
-    auto start = std::chrono::high_resolution_clock::now();
+template void advanced_binarization_gray<uint8_t>(const std::string &, const uint8_t *, int, int, int, float, float,
+                                                  const EngineChoice &, const PostprocessOptions &);
+template void advanced_binarization_gray<uint16_t>(const std::string &, const uint16_t *, int, int, int, float, float,
+                                                   const EngineChoice &, const PostprocessOptions &);
 
-    // Apply Sauvola binarization
-    std::vector<unsigned char> output_sauvola(width * height);
-    sauvola_binarize(gray.data(), output_sauvola.data(), width, height, window_size, k, R);
+/**
+ * Converts one loaded image to grayscale, optionally straightens it and runs
+ * advanced_binarization_gray on it.
+ *
+ * @param input_path Path of the image, used for the output paths.
+ * @param image Interleaved image data with channels samples per pixel.
+ */
+template <typename Pixel>
+static void run_advanced_binarization(const std::string &input_path, const Pixel *image,
+                                      int width, int height, int channels,
+                                      int window_size, float k, float R,
+                                      BinarizationEngine engine, const std::string &calibration_path,
+                                      const PostprocessOptions &postprocess, float max_skew) {
+    const int64_t pixels = static_cast<int64_t>(width) * height;
+
+    // Convert to grayscale; planes come from the arena, new blocks are first touched
+    // in parallel, so their pages are spread over the nodes of the threads that process them
+    Plane<Pixel> gray(static_cast<size_t>(width) * height);
+    {
+        PerfStage stage("gray", pixels);
+        convert_to_grayscale(image, channels, gray.data(), gray.size());
+    }
+    log_page_placement("gray plane", gray.data(), gray.size() * sizeof(Pixel));
 
-    if (!write_binary_image(output_path_sauvola, width, height, 1, output_sauvola.data())) {
-        spdlog::error("Failed to write Sauvola output image: {}", output_path_sauvola);
-    } else {
-        spdlog::info("Sauvola binarized image saved to: {}", output_path_sauvola);
+    // Straighten the page so that text lines run along the window rows
+    if (max_skew > 0.0f) {
+        PerfStage stage("deskew", pixels);
+        deskew_gray(gray.data(), width, height, max_skew);
     }
 
-    // Apply Nick binarization
-    std::vector<unsigned char> output_nick(width * height);
-    nick_binarize(gray.data(), output_nick.data(), width, height, window_size, k);
+    // Resolve the engine for this job; auto may also lower the thread count
+    const EngineChoice choice = choose_engine(engine, width, height, window_size, calibration_path);
+    advanced_binarization_gray(input_path, gray.data(), width, height, window_size, k, R, choice, postprocess);
+}
 
-    if (!write_binary_image(output_path_nick, width, height, 1, output_nick.data())) {
-        spdlog::error("Failed to write Nick output image: {}", output_path_nick);
-    } else {
-        spdlog::info("Nick binarized image saved to: {}", output_path_nick);
-    }
+/**
+ * Loads an image (8 or 16 bits per channel), converts it to grayscale, applies
+ * Sauvola and Nick binarization, and saves the results.
+ *
+ * @param input_path Path to the input image file.
+ * @param window_size Size of the local window for threshold calculation.
+ * @param k Parameter for thresholding.
+ * @param R Dynamic range parameter for Sauvola's method (8-bit units).
+ * @param engine How local statistics are computed (naive, integral or auto-selected).
+ * @param calibration_path Cost table used by the auto engine.
+ * @param postprocess Post-processing applied to both outputs before writing.
+ * @param max_skew Largest skew corrected before binarization in degrees; 0 disables deskewing.
+ */
 
-    auto end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<float> duration = end - start;
-    spdlog::info("Advanced binarization process completed in {} seconds.", duration.count());
+void process_advanced_binarization(const std::string &input_path, int window_size, float k, float R,
+                                   BinarizationEngine engine, const std::string &calibration_path,
+                                   const PostprocessOptions &postprocess, float max_skew) {
+    spdlog::info("Processing advanced binarization for: {} with window size {}, k={}, R={}, engine={}, morphology={}",
+                 input_path, window_size, k, R, engine_name(engine), morphology_op_name(postprocess.morphology.op));
+    PerfJob job("advanced");
 
+    int width, height, channels;
+
+    // Load the image, keeping 16 bits per channel when the file has them
+    if (is_16bit_image(input_path)) {
+        uint16_t *image = load_image<uint16_t>(input_path, width, height, channels);
+        if (!image) {
+            spdlog::error("Failed to load image: {}", input_path);
+            return;
+        }
+        spdlog::info("16-bit input, binarizing at full precision");
+        run_advanced_binarization(input_path, image, width, height, channels, window_size, k, R,
+                                  engine, calibration_path, postprocess, max_skew);
+        stbi_image_free(image);
+        return;
+    }
+
+    unsigned char *image = load_image<unsigned char>(input_path, width, height, channels);
+    if (!image) {
+        spdlog::error("Failed to load image: {}", input_path);
+        return;
+    }
+    run_advanced_binarization(input_path, image, width, height, channels, window_size, k, R,
+                              engine, calibration_path, postprocess, max_skew);
     stbi_image_free(image);
 }
@@ -0,0 +1,241 @@
+#include <binarization/connected_components.h>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <omp.h>
+#include <spdlog/spdlog.h>
+
+// Rows per strip; strips are labelled independently and merged afterwards
+constexpr int STRIP_HEIGHT = 64;
+
+/**
+ * Union-find over run indices that may be used by several threads at once.
+ * Roots are only ever linked below a smaller index with a compare-and-swap, so
+ * every parent pointer points to a smaller (or equal) index and the root of a
+ * component is its first run in raster order. Path halving writes only to
+ * non-root entries and always stores an ancestor, so it cannot race with a link.
+ */
+class ConcurrentUnionFind {
+public:
+    explicit ConcurrentUnionFind(size_t size) : parent_(size) {
+        #pragma omp parallel for schedule(static)
+        for (int64_t i = 0; i < static_cast<int64_t>(size); ++i) {
+            parent_[i].store(static_cast<int32_t>(i), std::memory_order_relaxed);
+        }
+    }
+
+    int32_t find(int32_t x) {
+        int32_t p = parent_[x].load(std::memory_order_relaxed);
+        while (p != x) {
+            const int32_t gp = parent_[p].load(std::memory_order_relaxed);
+            if (gp != p) parent_[x].store(gp, std::memory_order_relaxed);
+            x = p;
+            p = parent_[x].load(std::memory_order_relaxed);
+        }
+        return x;
+    }
+
+    void unite(int32_t a, int32_t b) {
+        while (true) {
+            a = find(a);
+            b = find(b);
+            if (a == b) return;
+            if (a < b) std::swap(a, b);
+            // Link the larger root below the smaller one; retry if a was linked meanwhile
+            int32_t expected = a;
+            if (parent_[a].compare_exchange_weak(expected, b, std::memory_order_acq_rel)) return;
+        }
+    }
+
+private:
+    std::vector<std::atomic<int32_t>> parent_;
+};
+
+/**
+ * Appends the runs of one packed row. Run starts are the 1 bits whose left
+ * neighbour is 0 and run ends the 0 bits whose left neighbour is 1, so a word
+ * is handled with a few shifts plus one count-trailing-zeros per run boundary.
+ */
+static void extract_row_runs(const uint64_t *row, int words, int width, int y, std::vector<PixelRun> &runs) {
+    uint64_t carry = 0; // last bit of the previous word
+    int start = -1;
+    for (int j = 0; j < words; ++j) {
+        const uint64_t w = row[j];
+        const uint64_t left = (w << 1) | carry;
+        uint64_t starts = w & ~left;
+        uint64_t ends = ~w & left;
+        // Boundaries alternate, so consume them in order of position
+        while (starts | ends) {
+            const int s = starts ? __builtin_ctzll(starts) : 64;
+            const int e = ends ? __builtin_ctzll(ends) : 64;
+            if (s < e) {
+                start = 64 * j + s;
+                starts &= starts - 1;
+            } else {
+                runs.push_back({y, start, 64 * j + e});
+                ends &= ends - 1;
+            }
+        }
+        carry = w >> 63;
+    }
+    if (carry) {
+        runs.push_back({y, start, width});
+    }
+}
+
+// Unites the 8-connected runs of two neighbouring rows (both sorted by x)
+static void unite_rows(const std::vector<PixelRun> &runs, int32_t prev_begin, int32_t prev_end,
+                       int32_t cur_begin, int32_t cur_end, ConcurrentUnionFind &sets) {
+    int32_t i = prev_begin, j = cur_begin;
+    while (i < prev_end && j < cur_end) {
+        const PixelRun &a = runs[i];
+        const PixelRun &b = runs[j];
+        if (a.x_begin <= b.x_end && b.x_begin <= a.x_end) {
+            sets.unite(i, j);
+        }
+        if (a.x_end < b.x_end) ++i; else ++j;
+    }
+}
+
+/**
+ * Labels the 8-connected ink components of a bit plane.
+ *
+ * 1. Every strip of STRIP_HEIGHT rows extracts its runs in parallel; the strip
+ *    results are concatenated in raster order.
+ * 2. Every strip unites the overlapping runs of its neighbouring rows.
+ * 3. The strip boundaries are merged in parallel on the same union-find.
+ * 4. Roots get consecutive labels in raster order; statistics are accumulated
+ *    per run (area, bounding box, coordinate sums for the centroid).
+ *
+ * @param image Bit plane, 1 = ink.
+ * @param labeling Runs, run labels and component statistics.
+ */
+void label_components(const PackedBinaryImage &image, ComponentLabeling &labeling) {
+    const int height = image.height;
+    const int strips = (height + STRIP_HEIGHT - 1) / STRIP_HEIGHT;
+
+    // 1. Runs per strip, then concatenated with row offsets
+    std::vector<std::vector<PixelRun>> strip_runs(strips);
+    std::vector<int32_t> row_offset(height + 1, 0);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int s = 0; s < strips; ++s) {
+        for (int y = s * STRIP_HEIGHT; y < std::min(height, (s + 1) * STRIP_HEIGHT); ++y) {
+            const size_t before = strip_runs[s].size();
+            extract_row_runs(image.row(y), image.words_per_row, image.width, y, strip_runs[s]);
+            row_offset[y + 1] = static_cast<int32_t>(strip_runs[s].size() - before);
+        }
+    }
+
+    std::vector<size_t> strip_offset(strips + 1, 0);
+    for (int s = 0; s < strips; ++s) {
+        strip_offset[s + 1] = strip_offset[s] + strip_runs[s].size();
+    }
+    for (int y = 0; y < height; ++y) {
+        row_offset[y + 1] += row_offset[y];
+    }
+
+    std::vector<PixelRun> &runs = labeling.runs;
+    runs.resize(strip_offset[strips]);
+    #pragma omp parallel for schedule(static)
+    for (int s = 0; s < strips; ++s) {
+        std::copy(strip_runs[s].begin(), strip_runs[s].end(), runs.begin() + strip_offset[s]);
+    }
+    strip_runs.clear();
+
+    // 2. Rows inside each strip
+    ConcurrentUnionFind sets(runs.size());
+    #pragma omp parallel for schedule(dynamic)
+    for (int s = 0; s < strips; ++s) {
+        for (int y = s * STRIP_HEIGHT + 1; y < std::min(height, (s + 1) * STRIP_HEIGHT); ++y) {
+            unite_rows(runs, row_offset[y - 1], row_offset[y], row_offset[y], row_offset[y + 1], sets);
+        }
+    }
+
+    // 3. Strip boundaries
+    #pragma omp parallel for schedule(static)
+    for (int s = 1; s < strips; ++s) {
+        const int y = s * STRIP_HEIGHT;
+        unite_rows(runs, row_offset[y - 1], row_offset[y], row_offset[y], row_offset[y + 1], sets);
+    }
+
+    // 4. Consecutive labels (roots are the first run of their component) and statistics
+    const int32_t run_count = static_cast<int32_t>(runs.size());
+    std::vector<int32_t> &run_labels = labeling.run_labels;
+    run_labels.assign(run_count, -1);
+    int32_t components = 0;
+    for (int32_t i = 0; i < run_count; ++i) {
+        if (sets.find(i) == i) run_labels[i] = components++;
+    }
+    #pragma omp parallel for schedule(static)
+    for (int32_t i = 0; i < run_count; ++i) {
+        run_labels[i] = run_labels[sets.find(i)];
+    }
+
+    labeling.components.assign(components, ComponentStats{0, image.width, height, -1, -1, 0.0, 0.0});
+    for (int32_t i = 0; i < run_count; ++i) {
+        const PixelRun &run = runs[i];
+        ComponentStats &c = labeling.components[run_labels[i]];
+        const int64_t length = run.x_end - run.x_begin;
+        c.area += length;
+        c.x_min = std::min(c.x_min, run.x_begin);
+        c.x_max = std::max(c.x_max, run.x_end - 1);
+        c.y_min = std::min(c.y_min, run.y);
+        c.y_max = std::max(c.y_max, run.y);
+        c.centroid_x += 0.5 * static_cast<double>(run.x_begin + run.x_end - 1) * length;
+        c.centroid_y += static_cast<double>(run.y) * length;
+    }
+    #pragma omp parallel for schedule(static)
+    for (int32_t c = 0; c < components; ++c) {
+        ComponentStats &stats = labeling.components[c];
+        stats.centroid_x /= static_cast<double>(stats.area);
+        stats.centroid_y /= static_cast<double>(stats.area);
+    }
+}
+
+/**
+ * Sets all runs of components smaller than min_area to background (255).
+ *
+ * @param binary 0/255 image the labeling was computed from.
+ * @param width Image width.
+ * @return Number of removed components.
+ */
+int remove_small_components(unsigned char *binary, int width, const ComponentLabeling &labeling, int64_t min_area) {
+    const int32_t run_count = static_cast<int32_t>(labeling.runs.size());
+
+    #pragma omp parallel for schedule(static)
+    for (int32_t i = 0; i < run_count; ++i) {
+        if (labeling.components[labeling.run_labels[i]].area < min_area) {
+            const PixelRun &run = labeling.runs[i];
+            std::fill(binary + static_cast<size_t>(run.y) * width + run.x_begin,
+                      binary + static_cast<size_t>(run.y) * width + run.x_end, 255);
+        }
+    }
+
+    return static_cast<int>(std::count_if(labeling.components.begin(), labeling.components.end(),
+                                          [&](const ComponentStats &c) { return c.area < min_area; }));
+}
+
+/**
+ * Writes one CSV line per component with at least min_area pixels. Labels
+ * keep their numbering from label_components.
+ */
+bool write_component_stats(const std::string &path, const ComponentLabeling &labeling, int64_t min_area) {
+    std::ofstream ofs(path);
+    if (!ofs) {
+        spdlog::error("Failed to open component statistics file: {}", path);
+        return false;
+    }
+
+    ofs << "label,area,x_min,y_min,x_max,y_max,centroid_x,centroid_y\n";
+    size_t written = 0;
+    for (size_t i = 0; i < labeling.components.size(); ++i) {
+        const ComponentStats &c = labeling.components[i];
+        if (c.area < min_area) continue;
+        ++written;
+        ofs << i << ',' << c.area << ',' << c.x_min << ',' << c.y_min << ',' << c.x_max << ',' << c.y_max << ','
+            << c.centroid_x << ',' << c.centroid_y << '\n';
+    }
+    spdlog::info("Component statistics ({} components) saved to: {}", written, path);
+    return true;
+}
@@ -0,0 +1,229 @@
+#include <binarization/deskew.h>
+#include <utils/plane_arena.h>
+#include <utils/pixel_traits.h>
+#include <utils/trace.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <omp.h>
+#include <spdlog/spdlog.h>
+
+constexpr double DEG_TO_RAD = 3.14159265358979323846 / 180.0;
+
+/**
+ * Sharpness of the horizontal projection profile after undoing a skew of
+ * `angle` degrees: every 64-pixel word of row y is counted with one popcount
+ * into bin y - round(dx * tan(angle)), dx being the distance of the word centre
+ * from the image centre. Text lines aligned with the bins give tall, narrow
+ * peaks, which maximise the sum of squared differences of neighbouring bins.
+ */
+static double profile_score(const PackedBinaryImage &image, double angle, std::vector<int32_t> &profile) {
+    const double slope = std::tan(angle * DEG_TO_RAD);
+    const int words = image.words_per_row;
+    const double centre = 0.5 * image.width;
+    const int reach = static_cast<int>(std::ceil(std::abs(slope) * (64.0 * words))) + 1;
+
+    std::vector<int> shift(words);
+    for (int j = 0; j < words; ++j) {
+        shift[j] = static_cast<int>(std::lround((64.0 * j + 32.0 - centre) * slope));
+    }
+
+    profile.assign(image.height + 2 * reach, 0);
+    for (int y = 0; y < image.height; ++y) {
+        const uint64_t *row = image.row(y);
+        int32_t *bins = profile.data() + reach + y;
+        for (int j = 0; j < words; ++j) {
+            if (row[j]) bins[-shift[j]] += __builtin_popcountll(row[j]);
+        }
+    }
+
+    double score = 0.0;
+    for (size_t i = 1; i < profile.size(); ++i) {
+        const double d = profile[i] - profile[i - 1];
+        score += d * d;
+    }
+    return score;
+}
+
+/**
+ * Evaluates `count` angles first + i * step in parallel and returns the best.
+ * Ties go to the angle closest to zero, so pages without text stay unrotated.
+ */
+static double best_angle(const PackedBinaryImage &image, double first, double step, int count) {
+    std::vector<double> scores(count);
+
+    #pragma omp parallel
+    {
+        std::vector<int32_t> profile;
+
+        #pragma omp for schedule(dynamic)
+        for (int i = 0; i < count; ++i) {
+            TraceSpan span("skew_profile");
+            scores[i] = profile_score(image, first + i * step, profile);
+        }
+    }
+
+    int best = 0;
+    for (int i = 1; i < count; ++i) {
+        const double angle = first + i * step;
+        const double best_angle = first + best * step;
+        if (scores[i] > scores[best] || (scores[i] == scores[best] && std::abs(angle) < std::abs(best_angle))) {
+            best = i;
+        }
+    }
+    return first + best * step;
+}
+
+/**
+ * Estimates the skew of the text lines of a bit plane. A coarse search over
+ * [-max_angle, max_angle] is refined around its best angle with fine_step.
+ *
+ * @param image Bit plane, 1 = ink.
+ * @param max_angle Largest skew considered, in degrees.
+ * @param coarse_step Angle step of the first pass.
+ * @param fine_step Angle step of the refinement around the coarse optimum.
+ * @return Skew angle in degrees.
+ */
+float estimate_skew(const PackedBinaryImage &image, float max_angle, float coarse_step, float fine_step) {
+    if (image.width == 0 || image.height == 0 || max_angle <= 0.0f) return 0.0f;
+
+    const int coarse_half = std::max(1, static_cast<int>(std::ceil(max_angle / coarse_step)));
+    const double coarse = best_angle(image, -coarse_half * coarse_step, coarse_step, 2 * coarse_half + 1);
+
+    const int fine_half = std::max(1, static_cast<int>(std::ceil(coarse_step / fine_step)));
+    const double fine = best_angle(image, coarse - fine_half * fine_step, fine_step, 2 * fine_half + 1);
+
+    return static_cast<float>(std::clamp(fine, -static_cast<double>(max_angle), static_cast<double>(max_angle)));
+}
+
+// Horizontal shear: row y moves right by round(factor * (y - centre)); row copies only
+template <typename Pixel>
+static void shear_rows(const Pixel *input, Pixel *output, int width, int height,
+                       double factor, Pixel fill) {
+    const double centre = 0.5 * (height - 1);
+
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < height; ++y) {
+        const int s = static_cast<int>(std::lround(factor * (y - centre)));
+        const Pixel *src = input + static_cast<size_t>(y) * width;
+        Pixel *dst = output + static_cast<size_t>(y) * width;
+        const int x_begin = std::clamp(s, 0, width);
+        const int x_end = std::clamp(width + s, 0, width);
+        std::fill(dst, dst + x_begin, fill);
+        std::copy(src + x_begin - s, src + x_end - s, dst + x_begin);
+        std::fill(dst + x_end, dst + width, fill);
+    }
+}
+
+/**
+ * Vertical shear: column x moves down by round(factor * (x - centre)). The
+ * shift is constant over runs of columns, so every output row is assembled
+ * from a few contiguous segments of input rows instead of walking columns.
+ */
+template <typename Pixel>
+static void shear_columns(const Pixel *input, Pixel *output, int width, int height,
+                          double factor, Pixel fill) {
+    const double centre = 0.5 * (width - 1);
+
+    // Column segments [start, next start) with a constant shift
+    std::vector<int> seg_start, seg_shift;
+    for (int x = 0; x < width; ++x) {
+        const int s = static_cast<int>(std::lround(factor * (x - centre)));
+        if (seg_shift.empty() || seg_shift.back() != s) {
+            seg_start.push_back(x);
+            seg_shift.push_back(s);
+        }
+    }
+    seg_start.push_back(width);
+
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < height; ++y) {
+        Pixel *dst = output + static_cast<size_t>(y) * width;
+        for (size_t k = 0; k + 1 < seg_start.size(); ++k) {
+            const int sy = y - seg_shift[k];
+            const int x0 = seg_start[k], n = seg_start[k + 1] - x0;
+            if (sy >= 0 && sy < height) {
+                const Pixel *src = input + static_cast<size_t>(sy) * width + x0;
+                std::copy(src, src + n, dst + x0);
+            } else {
+                std::fill(dst + x0, dst + x0 + n, fill);
+            }
+        }
+    }
+}
+
+/**
+ * Rotates an image about its centre with Paeth's three-shear decomposition
+ * (horizontal, vertical, horizontal). Each pass only shifts whole rows or
+ * row segments by integer offsets, so memory is read and written row by row.
+ *
+ * @param input Input image (width x height, one channel, 8 or 16 bits).
+ * @param output Rotated image of the same size.
+ * @param angle Rotation in degrees; rotate_shear(img, out, estimate_skew(img)) straightens the text lines.
+ * @param fill Value for pixels rotated in from outside the image.
+ */
+template <typename Pixel>
+static void rotate_shear_impl(const Pixel *input, Pixel *output, int width, int height, float angle, Pixel fill) {
+    const double phi = angle * DEG_TO_RAD;
+    const double alpha = std::tan(0.5 * phi);
+    const double beta = -std::sin(phi);
+
+    Plane<Pixel> temp(static_cast<size_t>(width) * height);
+    shear_rows(input, output, width, height, alpha, fill);
+    shear_columns(output, temp.data(), width, height, beta, fill);
+    shear_rows(temp.data(), output, width, height, alpha, fill);
+}
+
+void rotate_shear(const unsigned char *input, unsigned char *output, int width, int height,
+                  float angle, unsigned char fill) {
+    rotate_shear_impl(input, output, width, height, angle, fill);
+}
+
+void rotate_shear(const uint16_t *input, uint16_t *output, int width, int height,
+                  float angle, uint16_t fill) {
+    rotate_shear_impl(input, output, width, height, angle, fill);
+}
+
+/**
+ * Estimates the skew of a grayscale page and straightens it in place.
+ *
+ * @param gray Grayscale image; pixels below half the value range count as ink for the estimate.
+ * @param max_angle Largest skew considered, in degrees.
+ * @return Estimated skew in degrees (0 if no rotation was applied).
+ */
+template <typename Pixel>
+static float deskew_gray_impl(Pixel *gray, int width, int height, float max_angle) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    PackedBinaryImage packed;
+    if constexpr (sizeof(Pixel) == 1) {
+        pack_binary(gray, width, height, packed);
+    } else {
+        // The ink test only needs the high byte
+        Plane<unsigned char> high(static_cast<size_t>(width) * height);
+        #pragma omp parallel for simd
+        for (size_t i = 0; i < high.size(); ++i) high[i] = static_cast<unsigned char>(gray[i] >> 8);
+        pack_binary(high.data(), width, height, packed);
+    }
+    const float angle = estimate_skew(packed, max_angle);
+
+    if (angle != 0.0f) {
+        Plane<Pixel> rotated(static_cast<size_t>(width) * height);
+        rotate_shear(gray, rotated.data(), width, height, angle, static_cast<Pixel>(PixelTraits<Pixel>::max_value));
+        std::copy(rotated.begin(), rotated.end(), gray);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<float> duration = end - start;
+    spdlog::info("Deskew: estimated skew {:.2f} degrees in {} seconds.", angle, duration.count());
+    return angle;
+}
+
+float deskew_gray(unsigned char *gray, int width, int height, float max_angle) {
+    return deskew_gray_impl(gray, width, height, max_angle);
+}
+
+float deskew_gray(uint16_t *gray, int width, int height, float max_angle) {
+    return deskew_gray_impl(gray, width, height, max_angle);
+}
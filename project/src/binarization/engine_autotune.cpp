@@ -0,0 +1,225 @@
+#include <binarization/engine_autotune.h>
+#include <binarization/adaptive_thresholding.h>
+#include <binarization/integral_binarization.h>
+#include <binarization/integral_image.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <vector>
+#include <omp.h>
+#include <spdlog/spdlog.h>
+
+const char* const DEFAULT_CALIBRATION_PATH = "engine_calibration.txt";
+
+// Measured cost model for one thread count (all values in nanoseconds per pixel)
+struct EngineCost {
+    int threads;
+    double naive_base_ns;   // per-pixel overhead of the naive engine
+    double naive_tap_ns;    // additional cost per window element
+    double integral_ns;     // integral build + query
+};
+
+bool parse_engine(const std::string &name, BinarizationEngine &engine) {
+    if (name == "naive") {
+        engine = BinarizationEngine::Naive;
+    } else if (name == "integral") {
+        engine = BinarizationEngine::Integral;
+    } else if (name == "auto") {
+        engine = BinarizationEngine::Auto;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* engine_name(BinarizationEngine engine) {
+    switch (engine) {
+        case BinarizationEngine::Naive: return "naive";
+        case BinarizationEngine::Integral: return "integral";
+        case BinarizationEngine::Auto: return "auto";
+    }
+    return "unknown";
+}
+
+/**
+ * Thread counts that are calibrated: powers of two up to the OpenMP maximum,
+ * plus the maximum itself.
+ */
+static std::vector<int> calibration_thread_counts() {
+    const int max_threads = omp_get_max_threads();
+    std::vector<int> counts;
+    for (int t = 1; t < max_threads; t *= 2) {
+        counts.push_back(t);
+    }
+    counts.push_back(max_threads);
+    return counts;
+}
+
+/**
+ * Runs fn `repetitions` times and returns the fastest wall-clock time in seconds.
+ */
+template <typename Fn>
+static double best_of(int repetitions, Fn fn) {
+    double best = std::numeric_limits<double>::max();
+    for (int r = 0; r < repetitions; r++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        fn();
+        auto end = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double>(end - start).count());
+    }
+    return best;
+}
+
+/**
+ * Measures per-pixel costs of the naive and the integral engine for every
+ * calibrated thread count and writes them to calibration_path.
+ *
+ * The naive engine is measured at two window sizes so that its cost can be
+ * split into a per-pixel base and a per-window-element part. The synthetic
+ * page is a smooth gradient with noise, which has the same access pattern as
+ * a real scan.
+ *
+ * @param calibration_path Output file for the cost table.
+ * @return true if the file was written.
+ */
+bool calibrate_engines(const std::string &calibration_path) {
+    spdlog::info("Calibrating binarization engines, writing cost table to: {}", calibration_path);
+
+    const int width = 384, height = 384;
+    const int small_win = 7, large_win = 21;
+    std::vector<unsigned char> gray(width * height);
+    unsigned int seed = 12345u;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            seed = seed * 1664525u + 1013904223u;
+            gray[y * width + x] = static_cast<unsigned char>((x + y) / 4 + (seed >> 28));
+        }
+    }
+    std::vector<unsigned char> out(width * height);
+    const double pixels = static_cast<double>(width) * height;
+
+    // The kernels log at info level on every call; keep the calibration quiet
+    const auto previous_level = spdlog::get_level();
+    spdlog::set_level(spdlog::level::warn);
+    const int previous_threads = omp_get_max_threads();
+
+    std::vector<EngineCost> costs;
+    for (int threads : calibration_thread_counts()) {
+        omp_set_num_threads(threads);
+
+        const double naive_small = best_of(3, [&] {
+            sauvola_binarize(gray.data(), out.data(), width, height, small_win, 0.2f, 128.0f);
+        });
+        const double naive_large = best_of(3, [&] {
+            sauvola_binarize(gray.data(), out.data(), width, height, large_win, 0.2f, 128.0f);
+        });
+        const double integral = best_of(5, [&] {
+            IntegralImage integral_img(gray.data(), width, height);
+            sauvola_binarize_integral(integral_img, gray.data(), out.data(), small_win, 0.2f, 128.0f);
+        });
+
+        const double taps_small = static_cast<double>(small_win) * small_win;
+        const double taps_large = static_cast<double>(large_win) * large_win;
+        EngineCost cost{};
+        cost.threads = threads;
+        cost.naive_tap_ns = std::max(0.0, (naive_large - naive_small) / (taps_large - taps_small)) / pixels * 1e9;
+        cost.naive_base_ns = std::max(0.0, naive_small / pixels * 1e9 - cost.naive_tap_ns * taps_small);
+        cost.integral_ns = integral / pixels * 1e9;
+        costs.push_back(cost);
+    }
+
+    omp_set_num_threads(previous_threads);
+    spdlog::set_level(previous_level);
+
+    std::ofstream ofs(calibration_path);
+    if (!ofs) {
+        spdlog::error("Failed to write calibration file: {}", calibration_path);
+        return false;
+    }
+    ofs << "# image_processor engine calibration (ns per pixel)\n";
+    ofs << "# threads naive_base_ns naive_tap_ns integral_ns\n";
+    for (const auto &cost : costs) {
+        ofs << cost.threads << " " << cost.naive_base_ns << " " << cost.naive_tap_ns << " " << cost.integral_ns << "\n";
+        spdlog::info("Calibration threads={} naive={:.3f}+{:.4f}*taps ns/px integral={:.3f} ns/px",
+                     cost.threads, cost.naive_base_ns, cost.naive_tap_ns, cost.integral_ns);
+    }
+    return true;
+}
+
+/**
+ * Reads a cost table written by calibrate_engines. Comment lines start with '#'.
+ */
+static bool load_calibration(const std::string &calibration_path, std::vector<EngineCost> &costs) {
+    std::ifstream ifs(calibration_path);
+    if (!ifs) {
+        return false;
+    }
+    costs.clear();
+    std::string line;
+    while (std::getline(ifs, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream iss(line);
+        EngineCost cost{};
+        if (iss >> cost.threads >> cost.naive_base_ns >> cost.naive_tap_ns >> cost.integral_ns && cost.threads > 0) {
+            costs.push_back(cost);
+        }
+    }
+    return !costs.empty();
+}
+
+/**
+ * Resolves the engine and thread count for one job.
+ *
+ * Explicit engines are returned unchanged with the current OpenMP thread count.
+ * For BinarizationEngine::Auto the predicted runtime of every engine at every
+ * calibrated thread count is compared and the cheapest is chosen. Thread
+ * counts above the current OpenMP maximum are ignored. A missing calibration
+ * file triggers a one-time calibration run.
+ *
+ * @param requested Engine requested on the command line.
+ * @param width, height Image dimensions.
+ * @param window_size Window size of the job.
+ * @param calibration_path Cost table location.
+ * @return The chosen engine and thread count.
+ */
+EngineChoice choose_engine(BinarizationEngine requested, int width, int height, int window_size,
+                           const std::string &calibration_path) {
+    EngineChoice choice{requested, omp_get_max_threads()};
+    if (requested != BinarizationEngine::Auto) {
+        return choice;
+    }
+
+    std::vector<EngineCost> costs;
+    if (!load_calibration(calibration_path, costs)) {
+        if (!calibrate_engines(calibration_path) || !load_calibration(calibration_path, costs)) {
+            spdlog::warn("No usable engine calibration, falling back to the integral engine");
+            choice.engine = BinarizationEngine::Integral;
+            return choice;
+        }
+    }
+
+    const double pixels = static_cast<double>(width) * height;
+    const double taps = static_cast<double>(window_size) * window_size;
+    double best_seconds = std::numeric_limits<double>::max();
+    choice.engine = BinarizationEngine::Integral;
+    for (const auto &cost : costs) {
+        if (cost.threads > omp_get_max_threads()) continue;
+        const double naive_seconds = pixels * (cost.naive_base_ns + cost.naive_tap_ns * taps) * 1e-9;
+        const double integral_seconds = pixels * cost.integral_ns * 1e-9;
+        if (naive_seconds < best_seconds) {
+            best_seconds = naive_seconds;
+            choice = {BinarizationEngine::Naive, cost.threads};
+        }
+        if (integral_seconds < best_seconds) {
+            best_seconds = integral_seconds;
+            choice = {BinarizationEngine::Integral, cost.threads};
+        }
+    }
+
+    spdlog::info("Engine auto-selection for {}x{} window {}: {} with {} thread(s), predicted {:.4f} seconds",
+                 width, height, window_size, engine_name(choice.engine), choice.threads, best_seconds);
+    return choice;
+}
@@ -1,9 +1,18 @@
 #include <binarization/integral_binarization.h>
+#include <binarization/integral_image.h>
+#include <binarization/deskew.h>
 #include <utils/image_io.h>
+#include <utils/numa.h>
+#include <utils/plane_arena.h>
+#include <utils/perf_report.h>
+#include <utils/trace.h>
 #include <iostream>
 #include <fstream>
 #include <filesystem>
 #include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
 #include <chrono>
 #include <omp.h>
 #include <stb_image.h>
@@ -11,142 +20,179 @@
 #include <spdlog/spdlog.h>
 
 /**
- * Computes integral images for fast local mean and variance computation.
- *
- * @param gray Input grayscale image.
- * @param width Image width.
- * @param height Image height.
- * @param integralImg Output integral image.
- * @param integralImgSq Output squared integral image (for variance calculation).
+ * Thresholds the pixels [x_begin, x_end) of row y whose window lies fully inside
+ * the image. The window sums reduce to four contiguous streams per plane and the
+ * loop carries no branches, so it vectorises.
  */
 
-void computeIntegralImages(const unsigned char* gray,
-                           int width, int height,
-                           std::vector<float>& integralImg,
-                           std::vector<float>& integralImgSq)
+template <typename Pixel, typename ThresholdFunc>
+void binarize_interior_row(const Pixel* gray, unsigned char* out,
+                           const BasicIntegralImage<Pixel>& integral,
+                           int y, int x_begin, int x_end, int half_win,
+                           const ThresholdFunc &threshold_func)
 {
-    integralImg.resize(width * height, 0.0);
-    integralImgSq.resize(width * height, 0.0);
-
-    // 1. Row-wise scan (prefix sums per row)
-#pragma omp parallel for
-    for (int y = 0; y < height; y++) {
-        float sumRow = 0.0, sumRowSq = 0.0;
-        for (int x = 0; x < width; x++) {
-            float val = static_cast<float>(gray[y * width + x]);
-            sumRow   += val;
-            sumRowSq += val * val;
-            integralImg[y * width + x]   = sumRow;
-            integralImgSq[y * width + x] = sumRowSq;
-        }
-    }
-
-    // 2. Column-wise scan (prefix sums of the already row-summed data)
-#pragma omp parallel for
-    for (int x = 0; x < width; x++) {
-        float colSum = 0.0, colSumSq = 0.0;
-        for (int y = 0; y < height; y++) {
-            colSum   += integralImg[y * width + x];
-            colSumSq += integralImgSq[y * width + x];
-            integralImg[y * width + x]   = colSum;
-            integralImgSq[y * width + x] = colSumSq;
-        }
+    using sum_type = typename BasicIntegralImage<Pixel>::sum_type;
+    const size_t stride = integral.stride();
+    const size_t top = static_cast<size_t>(y - half_win) * stride;
+    const size_t bottom = static_cast<size_t>(y + half_win + 1) * stride;
+    const sum_type* A = integral.sum_plane() + top - half_win;
+    const sum_type* B = integral.sum_plane() + top + half_win + 1;
+    const sum_type* C = integral.sum_plane() + bottom - half_win;
+    const sum_type* D = integral.sum_plane() + bottom + half_win + 1;
+    const uint64_t* ASq = integral.sum_sq_plane() + top - half_win;
+    const uint64_t* BSq = integral.sum_sq_plane() + top + half_win + 1;
+    const uint64_t* CSq = integral.sum_sq_plane() + bottom - half_win;
+    const uint64_t* DSq = integral.sum_sq_plane() + bottom + half_win + 1;
+    const size_t row = static_cast<size_t>(y) * integral.width();
+    const uint64_t area = static_cast<uint64_t>(2 * half_win + 1) * (2 * half_win + 1);
+
+    #pragma omp simd
+    for (int x = x_begin; x < x_end; x++) {
+        const uint64_t sum = static_cast<sum_type>(D[x] - B[x] - C[x] + A[x]);
+        const uint64_t sumSq = DSq[x] - BSq[x] - CSq[x] + ASq[x];
+        const double inv_area = 1.0 / static_cast<double>(area);
+        const double var = variance_numerator<Pixel>(area, sum, sumSq) * inv_area * inv_area;
+        const float mean = static_cast<float>(static_cast<double>(sum) * inv_area);
+        const float stddev = (var > 0.0) ? static_cast<float>(std::sqrt(var)) : 0.0f;
+        out[row + x] = (gray[row + x] > threshold_func(mean, stddev)) ? 255 : 0;
     }
 }
 
 /**
- * Retrieves the sum of pixel values in a rectangular region using the integral image.
+ * Adaptive binarization using integral images.
  *
- * @param integralImg Integral image.
- * @param x1, y1 Top-left corner of the region.
- * @param x2, y2 Bottom-right corner of the region.
- * @param width Image width.
- * @param height Image height.
- * @return Sum of pixel values in the region.
+ * Rows and columns closer than half a window to the border go through the
+ * clamped query; everything else through the branch-free interior row kernel.
  */
 
-inline float getSum(const std::vector<float>& integralImg,
-                     int x1, int y1, int x2, int y2, int width, int height)
-{
-    // Clamping region boundaries
-    if (x1 < 0) x1 = 0; if (y1 < 0) y1 = 0;
-    if (x2 >= width) x2 = width - 1;
-    if (y2 >= height) y2 = height - 1;
-
-    // Using the inclusion-exclusion principle to compute region sum efficiently
-    float A = (x1 > 0 && y1 > 0) ? integralImg[(y1 - 1) * width + (x1 - 1)] : 0.0;
-    float B = (y1 > 0) ? integralImg[(y1 - 1) * width + x2] : 0.0;
-    float C = (x1 > 0) ? integralImg[y2 * width + (x1 - 1)] : 0.0;
-    float D = integralImg[y2 * width + x2];
-    return D + A - B - C;
+template <typename Pixel, typename ThresholdFunc>
+void adaptive_binarize_integral(const BasicIntegralImage<Pixel>& integral,
+                       const Pixel* gray,
+                       unsigned char* out,
+                       int window_size,
+                       const ThresholdFunc &threshold_func) {
+    const int width = integral.width();
+    const int height = integral.height();
+    int half_win = window_size / 2;
+
+    SPDLOG_DEBUG("Starting adaptive integral binarization with window size {}", window_size);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // Interior columns [x_begin, x_end) are the same for every interior row
+    const int x_begin = std::min(half_win, width);
+    const int x_end = std::max(x_begin, width - half_win);
+
+    auto border_pixel = [&](int x, int y) {
+        float mean = 0.0f, stddev = 0.0f;
+        integral.mean_std(x, y, half_win, mean, stddev);
+        float threshold = threshold_func(mean, stddev);
+        out[y * width + x] = (gray[y * width + x] > threshold) ? 255 : 0;
+    };
+
+    // nowait: the trace span of each thread ends with its own rows
+    #pragma omp parallel
+    {
+        TraceSpan span("adaptive_binarize_integral");
+
+        #pragma omp for schedule(static) nowait
+        for (int y = 0; y < height; y++) {
+            if (y < half_win || y >= height - half_win) {
+                for (int x = 0; x < width; x++) border_pixel(x, y);
+                continue;
+            }
+            for (int x = 0; x < x_begin; x++) border_pixel(x, y);
+            binarize_interior_row(gray, out, integral, y, x_begin, x_end, half_win, threshold_func);
+            for (int x = x_end; x < width; x++) border_pixel(x, y);
+        }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<float> duration = end - start;
+    SPDLOG_DEBUG("Adaptive integral binarization completed in {} seconds.", duration.count());
 }
 
 /**
- * Computes the local mean and standard deviation using integral images.
+ * Implements Sauvola's binarization using a prebuilt integral image.
  *
- * @param integralImg Integral image.
- * @param integralImgSq Squared integral image.
- * @param width Image width.
- * @param height Image height.
- * @param x, y Pixel coordinates.
- * @param half_win Half of the local window size.
- * @param mean Output mean value.
- * @param stddev Output standard deviation value.
+ * @param integral Integral image of gray.
+ * @param gray Input grayscale image data.
+ * @param out Output binarized image data.
+ * @param window_size Size of the local window for threshold calculation.
+ * @param k Parameter that adjusts the thresholding sensitivity.
+ * @param R Dynamic range of standard deviation (typically 128 for 8-bit images, 128 * 257 for 16-bit images).
  */
 
-void local_mean_std_integral(const std::vector<float>& integralImg,
-                             const std::vector<float>& integralImgSq,
-                             int width, int height,
-                             int x, int y, int half_win,
-                             float &mean, float &stddev)
-{
-    int x1 = x - half_win, y1 = y - half_win;
-    int x2 = x + half_win, y2 = y + half_win;
-    float area = (x2 - x1 + 1) * (y2 - y1 + 1);
+template <typename Pixel>
+static void sauvola_binarize_integral_impl(const BasicIntegralImage<Pixel>& integral,
+                                           const Pixel* gray,
+                                           unsigned char* out,
+                                           int window_size,
+                                           float k,
+                                           float R) {
+    SPDLOG_DEBUG("Starting Integral Sauvola binarization with window size {}, k={}, R={}.", window_size, k, R);
 
-    float sum = getSum(integralImg, x1, y1, x2, y2, width, height);
-    float sumSq = getSum(integralImgSq, x1, y1, x2, y2, width, height);
+    auto threshold_func = [k, R](float mean, float stddev) {
+        return mean * (1.0f + k * ((stddev / R) - 1.0f));
+    };
+
+    adaptive_binarize_integral(integral, gray, out, window_size, threshold_func);
 
-    float m = sum / area;
-    float var = (sumSq / area) - (m * m);
-    mean = static_cast<float>(m);
-    stddev = (var > 0.0) ? static_cast<float>(std::sqrt(var)) : 0.0f;
+    SPDLOG_DEBUG("Integral Sauvola binarization completed.");
 }
 
 /**
- * Adaptive binarization using integral images.
+ * Implements NICK binarization using a prebuilt integral image.
+ *
+ * Uses the same two window sums as Sauvola, so both can share one integral image.
+ *
+ * @param integral Integral image of gray.
+ * @param gray Input grayscale image data.
+ * @param out Output binarized image data.
+ * @param window_size Size of the local window for threshold calculation.
+ * @param k Parameter that adjusts the thresholding sensitivity.
  */
 
-void adaptive_binarize_integral(const unsigned char* gray,
-                       unsigned char* out,
-                       int width, int height,
-                       int window_size,
-                       const std::vector<float>& integralImg,
-                       const std::vector<float>& integralImgSq,
-                       const std::function<float(float mean, float stddev)> &threshold_func) {
-    int half_win = window_size / 2;
+template <typename Pixel>
+static void nick_binarize_integral_impl(const BasicIntegralImage<Pixel>& integral,
+                                        const Pixel* gray,
+                                        unsigned char* out,
+                                        int window_size,
+                                        float k) {
+    SPDLOG_DEBUG("Starting Integral Nick binarization with window size {}, k={}.", window_size, k);
+
+    // Same formula as nick_binarize() so both implementations agree
+    auto threshold_func = [k](float mean, float stddev) {
+        return mean - k * stddev;
+    };
 
-    spdlog::info("Starting adaptive integral binarization with window size {}", window_size);
+    adaptive_binarize_integral(integral, gray, out, window_size, threshold_func);
 
-    auto start = std::chrono::high_resolution_clock::now();
+    SPDLOG_DEBUG("Integral Nick binarization completed.");
+}
 
-    #pragma omp parallel for collapse(2)
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            float mean = 0.0f, stddev = 0.0f;
-            local_mean_std_integral(integralImg, integralImgSq, width, height, x, y, half_win, mean, stddev);
-            float threshold = threshold_func(mean, stddev);
-            out[y * width + x] = (gray[y * width + x] > threshold) ? 255 : 0;
-        }
-    }
+void sauvola_binarize_integral(const IntegralImage& integral, const unsigned char* gray, unsigned char* out,
+                               int window_size, float k, float R) {
+    sauvola_binarize_integral_impl(integral, gray, out, window_size, k, R);
+}
 
-    auto end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<float> duration = end - start;
-    spdlog::info("Adaptive integral binarization completed in {} seconds.", duration.count());
+void sauvola_binarize_integral(const IntegralImage16& integral, const uint16_t* gray, unsigned char* out,
+                               int window_size, float k, float R) {
+    sauvola_binarize_integral_impl(integral, gray, out, window_size, k, R);
+}
+
+void nick_binarize_integral(const IntegralImage& integral, const unsigned char* gray, unsigned char* out,
+                            int window_size, float k) {
+    nick_binarize_integral_impl(integral, gray, out, window_size, k);
+}
+
+void nick_binarize_integral(const IntegralImage16& integral, const uint16_t* gray, unsigned char* out,
+                            int window_size, float k) {
+    nick_binarize_integral_impl(integral, gray, out, window_size, k);
 }
 
 /**
- * Implements Sauvola's binarization using integral images.
+ * Convenience overload: builds the integral image and runs Sauvola once.
  */
 
 void sauvola_binarize_integral(const unsigned char* gray,
@@ -154,64 +200,179 @@ void sauvola_binarize_integral(const unsigned char* gray,
                                int width, int height,
                                int window_size,
                                float k,
-                               float R,
-                               const std::vector<float>& integralImg,
-                               const std::vector<float>& integralImgSq) {
-    spdlog::info("Starting Integral Sauvola binarization with window size {}, k={}, R={}.", window_size, k, R);
+                               float R) {
+    IntegralImage integral(gray, width, height);
+    sauvola_binarize_integral(integral, gray, out, window_size, k, R);
+}
 
-    auto threshold_func = [k, R](float mean, float stddev) {
-        return mean * (1.0f + k * ((stddev / R) - 1.0f));
-    };
+/**
+ * Runs integral Sauvola and Nick binarization for one window size on an
+ * integral image that is already built, and saves the results.
+ *
+ * @param input_path Path of the image, used for the output paths.
+ * @param integral Integral image of gray.
+ * @param gray Grayscale plane the integral image was built from.
+ * @param window_suffix Append "_w<size>" to the output names (several window sizes).
+ * @return Thresholding time in seconds (post-processing and writing excluded).
+ */
 
-    adaptive_binarize_integral(gray, out, width, height, window_size, integralImg, integralImgSq, threshold_func);
+template <typename Pixel>
+double integral_window_gray(const std::string &input_path, const BasicIntegralImage<Pixel> &integral,
+                            const Pixel *gray, int window_size, bool window_suffix, float k, float R,
+                            const PostprocessOptions &postprocess) {
+    const int width = integral.width(), height = integral.height();
+    const int64_t pixels = static_cast<int64_t>(width) * height;
+    double compute_seconds = 0.0;
+    Plane<unsigned char> output_integral(pixels);
+    const float range_R = R * pixel_range_scale<Pixel>();
+
+    // Keep the historic file names when only one window size is requested
+    const std::string suffix = window_suffix ? "_w" + std::to_string(window_size) : "";
+
+    // Run Sauvola binarization using integral images
+    std::string output_path_sauvola = make_output_path(input_path, "integralSauvola" + suffix);
+    {
+        PerfStage stage("threshold", pixels, "sauvola w=" + std::to_string(window_size));
+        sauvola_binarize_integral(integral, gray, output_integral.data(), window_size, k, range_R);
+        compute_seconds += stage.stop();
+    }
+    postprocess_binary(output_integral.data(), width, height, postprocess, output_path_sauvola);
+
+    if (!write_binary_image(output_path_sauvola, width, height, 1, output_integral.data())) {
+        spdlog::error("Failed to write Integral Sauvola output image: {}", output_path_sauvola);
+    } else {
+        spdlog::info("Integral Sauvola binarized image saved to: {}", output_path_sauvola);
+    }
+
+    // Run Nick binarization on the same integral image
+    std::string output_path_nick = make_output_path(input_path, "integralNick" + suffix);
+    {
+        PerfStage stage("threshold", pixels, "nick w=" + std::to_string(window_size));
+        nick_binarize_integral(integral, gray, output_integral.data(), window_size, k);
+        compute_seconds += stage.stop();
+    }
+    postprocess_binary(output_integral.data(), width, height, postprocess, output_path_nick);
 
-    spdlog::info("Integral Sauvola binarization completed.");
+    if (!write_binary_image(output_path_nick, width, height, 1, output_integral.data())) {
+        spdlog::error("Failed to write Integral Nick output image: {}", output_path_nick);
+    } else {
+        spdlog::info("Integral Nick binarized image saved to: {}", output_path_nick);
+    }
+
+    return compute_seconds;
 }
 
+template double integral_window_gray<uint8_t>(const std::string &, const IntegralImage &, const uint8_t *,
+                                              int, bool, float, float, const PostprocessOptions &);
+template double integral_window_gray<uint16_t>(const std::string &, const IntegralImage16 &, const uint16_t *,
+                                               int, bool, float, float, const PostprocessOptions &);
+
 /**
- * Processes the integral binarization for a given image.
+ * Runs integral Sauvola and Nick binarization for every requested window size
+ * on an integral image that is already built, and saves the results.
+ *
+ * @param input_path Path of the image, used for the output paths.
+ * @param integral Integral image of gray.
+ * @param gray Grayscale plane the integral image was built from.
+ * @return Thresholding time in seconds (post-processing and writing excluded).
  */
 
-void process_integral_binarization(const std::string &input_path, int window_size, float k, float R) {
-    spdlog::info("Processing integral binarization for: {} with window size {}, k={}, R={}", input_path, window_size, k, R);
-    int width, height, channels;
-    unsigned char *image = stbi_load(input_path.c_str(), &width, &height, &channels, 0);
-    if (!image) {
-        spdlog::error("Failed to load image: {}", input_path);
-        return;
+template <typename Pixel>
+double integral_binarization_gray(const std::string &input_path, const BasicIntegralImage<Pixel> &integral,
+                                  const Pixel *gray, const std::vector<int> &window_sizes, float k, float R,
+                                  const PostprocessOptions &postprocess) {
+    double compute_seconds = 0.0;
+    for (int window_size : window_sizes) {
+        compute_seconds += integral_window_gray(input_path, integral, gray, window_size, window_sizes.size() > 1,
+                                                k, R, postprocess);
+    }
+    return compute_seconds;
+}
+
+template double integral_binarization_gray<uint8_t>(const std::string &, const IntegralImage &, const uint8_t *,
+                                                    const std::vector<int> &, float, float, const PostprocessOptions &);
+template double integral_binarization_gray<uint16_t>(const std::string &, const IntegralImage16 &, const uint16_t *,
+                                                     const std::vector<int> &, float, float, const PostprocessOptions &);
+
+/**
+ * Builds the integral image of one loaded image once and runs integral Sauvola
+ * and Nick binarization for every requested window size. 16-bit images keep
+ * their full precision; R is given in 8-bit units and scaled to the pixel range.
+ *
+ * @param input_path Path of the image, used for the output paths.
+ * @param image Interleaved image data with channels samples per pixel.
+ */
+
+template <typename Pixel>
+static void run_integral_binarization(const std::string &input_path, const Pixel *image,
+                                      int width, int height, int channels,
+                                      const std::vector<int> &window_sizes, float k, float R,
+                                      const PostprocessOptions &postprocess, float max_skew) {
+    const int64_t pixels = static_cast<int64_t>(width) * height;
+
+    Plane<Pixel> gray(static_cast<size_t>(width) * height);
+    {
+        PerfStage stage("gray", pixels);
+        convert_to_grayscale(image, channels, gray.data(), gray.size());
     }
+    log_page_placement("gray plane", gray.data(), gray.size() * sizeof(Pixel));
 
-    std::vector<unsigned char> gray(width * height);
-    #pragma omp parallel for
-    for (int i = 0; i < width * height; i++) {
-        gray[i] = static_cast<unsigned char>(
-                0.2126f * image[i * channels + 0] +
-                0.7152f * image[i * channels + 1] +
-                0.0722f * image[i * channels + 2]);
+    // Straighten the page so that text lines run along the window rows
+    if (max_skew > 0.0f) {
+        PerfStage stage("deskew", pixels);
+        deskew_gray(gray.data(), width, height, max_skew);
     }
 
-    std::vector<float> integralImg, integralImgSq;
-    computeIntegralImages(gray.data(), width, height, integralImg, integralImgSq);
+    // Built once, shared by every window size and formula below
+    BasicIntegralImage<Pixel> integral;
+    double compute_seconds;
+    {
+        PerfStage stage("statistics", pixels, "integral image");
+        integral.build(gray.data(), width, height);
+        compute_seconds = stage.stop();
+    }
+    compute_seconds += integral_binarization_gray(input_path, integral, gray.data(), window_sizes, k, R, postprocess);
 
-    std::string output_path_integral = make_output_path(input_path, "integralSauvola");
-    std::vector<unsigned char> output_integral(width * height);
+    // Integral image and thresholding only; post-processing and writing are separate stages
+    spdlog::info("Integral binarization process completed in {} seconds.", compute_seconds);
+}
 
-    auto start = std::chrono::high_resolution_clock::now();
+/**
+ * Loads an image (8 or 16 bits per channel), builds its integral image once and
+ * runs integral Sauvola and Nick binarization for every requested window size.
+ *
+ * @param input_path Path to the input image file.
+ * @param window_sizes Window sizes to evaluate; all share the same integral image.
+ * @param k Parameter for thresholding.
+ * @param R Dynamic range parameter for Sauvola's method (8-bit units).
+ * @param postprocess Post-processing applied to every output before writing.
+ * @param max_skew Largest skew corrected before binarization in degrees; 0 disables deskewing.
+ */
 
-    // Run Sauvola binarization using integral images
-    sauvola_binarize_integral(gray.data(), output_integral.data(), width, height, window_size, k, R, integralImg, integralImgSq);
+void process_integral_binarization(const std::string &input_path, const std::vector<int> &window_sizes, float k, float R,
+                                   const PostprocessOptions &postprocess, float max_skew) {
+    spdlog::info("Processing integral binarization for: {} with {} window size(s), k={}, R={}, morphology={}",
+                 input_path, window_sizes.size(), k, R, morphology_op_name(postprocess.morphology.op));
+    PerfJob job("integral");
+    int width, height, channels;
 
-    if (!write_binary_image(output_path_integral, width, height, 1, output_integral.data())) {
-        spdlog::error("Failed to write Integral Sauvola output image: {}", output_path_integral);
-    } else {
-        spdlog::info("Integral Sauvola binarized image saved to: {}", output_path_integral);
+    if (is_16bit_image(input_path)) {
+        uint16_t *image = load_image<uint16_t>(input_path, width, height, channels);
+        if (!image) {
+            spdlog::error("Failed to load image: {}", input_path);
+            return;
+        }
+        spdlog::info("16-bit input, binarizing at full precision");
+        run_integral_binarization(input_path, image, width, height, channels, window_sizes, k, R, postprocess, max_skew);
+        stbi_image_free(image);
+        return;
     }
 
-    auto end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<float> duration = end - start;
-    spdlog::info("Integral binarization process completed in {} seconds.", duration.count());
-
+    unsigned char *image = load_image<unsigned char>(input_path, width, height, channels);
+    if (!image) {
+        spdlog::error("Failed to load image: {}", input_path);
+        return;
+    }
+    run_integral_binarization(input_path, image, width, height, channels, window_sizes, k, R, postprocess, max_skew);
     stbi_image_free(image);
 }
-
-
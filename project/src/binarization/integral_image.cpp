@@ -0,0 +1,198 @@
+#include <binarization/integral_image.h>
+#include <utils/trace.h>
+#include <algorithm>
+#include <cmath>
+#include <omp.h>
+
+template <typename Pixel>
+BasicIntegralImage<Pixel>::BasicIntegralImage(const Pixel* gray, int width, int height)
+{
+    build(gray, width, height);
+}
+
+/**
+ * Computes integral images for fast local mean and variance computation.
+ *
+ * Both planes hold exact unsigned integer prefix sums. The planes are allowed to
+ * wrap around on very large images: every window query is evaluated modulo 2^32
+ * (resp. 2^64), and since a single window sum never exceeds 255 * area (resp.
+ * 255^2 * area), the inclusion-exclusion result is still exact. This keeps the
+ * sum plane at 32 bits for images of any size without a tiled layout. 16-bit
+ * images use a 64-bit sum plane; 65535^2 still fits the 32-bit square term.
+ *
+ * The planes are padded with a leading zero row and column, i.e. they have
+ * (width + 1) x (height + 1) entries and entry (x + 1, y + 1) holds the sum over
+ * [0, x] x [0, y]. Window queries therefore never need to special-case the
+ * first row or column.
+ *
+ * @param gray Input grayscale image.
+ * @param width Image width.
+ * @param height Image height.
+ */
+
+template <typename Pixel>
+void BasicIntegralImage<Pixel>::build(const Pixel* gray, int width, int height)
+{
+    width_ = width;
+    height_ = height;
+    stride_ = static_cast<size_t>(width) + 1;
+    const size_t stride = stride_;
+    sum_.reallocate(stride * (height + 1));
+    sum_sq_.reallocate(stride * (height + 1));
+    std::fill(sum_.begin(), sum_.begin() + stride, 0);
+    std::fill(sum_sq_.begin(), sum_sq_.begin() + stride, 0);
+    if (width == 0 || height == 0) return;
+
+    // The image is split into horizontal bands, one per thread. Every pass walks
+    // the rows of a band in memory order; threads only meet at band boundaries.
+    const int bands = std::max(1, std::min(height, omp_get_max_threads()));
+    auto band_begin = [height, bands](int b) {
+        return static_cast<int>(static_cast<int64_t>(height) * b / bands);
+    };
+
+    // 1. Column sums of every band (plain vector adds along each row)
+    std::vector<sum_type> bandColSum(static_cast<size_t>(bands) * width, 0);
+    std::vector<uint64_t> bandColSumSq(static_cast<size_t>(bands) * width, 0);
+#pragma omp parallel for schedule(static)
+    for (int b = 1; b < bands; b++) {
+        TraceSpan span("integral_column_sums");
+        sum_type* colSum = bandColSum.data() + static_cast<size_t>(b - 1) * width;
+        uint64_t* colSumSq = bandColSumSq.data() + static_cast<size_t>(b - 1) * width;
+        for (int y = band_begin(b - 1); y < band_begin(b); y++) {
+            const Pixel* row = gray + static_cast<size_t>(y) * width;
+            #pragma omp simd
+            for (int x = 0; x < width; x++) {
+                const uint32_t val = row[x];
+                colSum[x]   += val;
+                colSumSq[x] += val * val;
+            }
+        }
+    }
+
+    // 2. Integral row just above each band (exclusive scan over the bands, then a
+    //    prefix along x). This is O(bands * width) and runs serially. Band 0 uses
+    //    the zero padding row.
+    std::vector<sum_type> carry(static_cast<size_t>(bands) * width, 0);
+    std::vector<uint64_t> carrySq(static_cast<size_t>(bands) * width, 0);
+    std::vector<sum_type> cumCol(width, 0);
+    std::vector<uint64_t> cumColSq(width, 0);
+    for (int b = 1; b < bands; b++) {
+        const size_t prev = static_cast<size_t>(b - 1) * width;
+        sum_type sumRow = 0;
+        uint64_t sumRowSq = 0;
+        for (int x = 0; x < width; x++) {
+            cumCol[x]   += bandColSum[prev + x];
+            cumColSq[x] += bandColSumSq[prev + x];
+            sumRow   += cumCol[x];
+            sumRowSq += cumColSq[x];
+            carry[static_cast<size_t>(b) * width + x]   = sumRow;
+            carrySq[static_cast<size_t>(b) * width + x] = sumRowSq;
+        }
+    }
+
+    // 3. Row-major integral: each row is its running row sum plus the previous
+    //    integral row, which is still in cache.
+#pragma omp parallel for schedule(static)
+    for (int b = 0; b < bands; b++) {
+        TraceSpan span("integral_rows");
+        const sum_type* prevRow = carry.data() + static_cast<size_t>(b) * width;
+        const uint64_t* prevRowSq = carrySq.data() + static_cast<size_t>(b) * width;
+        for (int y = band_begin(b); y < band_begin(b + 1); y++) {
+            const Pixel* row = gray + static_cast<size_t>(y) * width;
+            sum_type* outRow = sum_.data() + (y + 1) * stride;
+            uint64_t* outRowSq = sum_sq_.data() + (y + 1) * stride;
+            outRow[0] = 0;
+            outRowSq[0] = 0;
+            ++outRow;
+            ++outRowSq;
+            sum_type sumRow = 0;
+            uint64_t sumRowSq = 0;
+            for (int x = 0; x < width; x++) {
+                const uint32_t val = row[x];
+                sumRow   += val;
+                sumRowSq += val * val;
+                outRow[x]   = prevRow[x] + sumRow;
+                outRowSq[x] = prevRowSq[x] + sumRowSq;
+            }
+            prevRow = outRow;
+            prevRowSq = outRowSq;
+        }
+    }
+}
+
+/**
+ * Inclusion-exclusion on a padded plane for the region [x1, x2] x [y1, y2].
+ *
+ * The difference is taken in the (wrapping) unsigned type of the plane, which
+ * yields the exact region sum as long as it fits into that type.
+ */
+
+template <typename T>
+inline T region_sum(const Plane<T>& plane, size_t stride, int x1, int y1, int x2, int y2)
+{
+    const T* top = plane.data() + y1 * stride;
+    const T* bottom = plane.data() + (y2 + 1) * stride;
+    return bottom[x2 + 1] - top[x2 + 1] - bottom[x1] + top[x1];
+}
+
+template <typename Pixel>
+uint64_t BasicIntegralImage<Pixel>::sum(int x1, int y1, int x2, int y2) const
+{
+    return region_sum(sum_, stride_, x1, y1, x2, y2);
+}
+
+template <typename Pixel>
+uint64_t BasicIntegralImage<Pixel>::sum_sq(int x1, int y1, int x2, int y2) const
+{
+    return region_sum(sum_sq_, stride_, x1, y1, x2, y2);
+}
+
+/**
+ * Computes the local mean and variance of the window centred at (x, y).
+ *
+ * The window is clamped to the image and the area is the number of pixels
+ * actually inside it, so windows touching the border are normalised correctly.
+ * The variance numerator area * sumSq - sum^2 is evaluated in exact integer
+ * arithmetic before the single conversion to floating point (in double for
+ * 16-bit images, where it can exceed 64 bits for large windows).
+ *
+ * @param x, y Pixel coordinates.
+ * @param half_win Half of the local window size.
+ * @param mean Output mean value.
+ * @param variance Output variance.
+ */
+
+template <typename Pixel>
+void BasicIntegralImage<Pixel>::mean_variance(int x, int y, int half_win, float &mean, float &variance) const
+{
+    const int x1 = std::max(x - half_win, 0), y1 = std::max(y - half_win, 0);
+    const int x2 = std::min(x + half_win, width_ - 1), y2 = std::min(y + half_win, height_ - 1);
+    const uint64_t area = static_cast<uint64_t>(x2 - x1 + 1) * (y2 - y1 + 1);
+
+    const uint64_t s = sum(x1, y1, x2, y2);
+    const uint64_t sq = sum_sq(x1, y1, x2, y2);
+
+    const double inv_area = 1.0 / static_cast<double>(area);
+    mean = static_cast<float>(static_cast<double>(s) * inv_area);
+    variance = static_cast<float>(variance_numerator<Pixel>(area, s, sq) * inv_area * inv_area);
+}
+
+/**
+ * Computes the local mean and standard deviation of the window centred at (x, y).
+ *
+ * @param x, y Pixel coordinates.
+ * @param half_win Half of the local window size.
+ * @param mean Output mean value.
+ * @param stddev Output standard deviation value.
+ */
+
+template <typename Pixel>
+void BasicIntegralImage<Pixel>::mean_std(int x, int y, int half_win, float &mean, float &stddev) const
+{
+    float variance = 0.0f;
+    mean_variance(x, y, half_win, mean, variance);
+    stddev = (variance > 0.0f) ? std::sqrt(variance) : 0.0f;
+}
+
+template class BasicIntegralImage<uint8_t>;
+template class BasicIntegralImage<uint16_t>;
@@ -0,0 +1,351 @@
+#include <binarization/morphology.h>
+#include <algorithm>
+#include <chrono>
+#include <omp.h>
+#include <spdlog/spdlog.h>
+
+// Rows per work item of the band-parallel passes
+constexpr int BAND_HEIGHT = 32;
+
+// Largest supported structuring element side
+constexpr int MAX_SE_SIZE = 255;
+
+bool parse_morphology_op(const std::string &name, MorphologyOp &op) {
+    if (name == "none") {
+        op = MorphologyOp::None;
+    } else if (name == "erode") {
+        op = MorphologyOp::Erode;
+    } else if (name == "dilate") {
+        op = MorphologyOp::Dilate;
+    } else if (name == "open") {
+        op = MorphologyOp::Open;
+    } else if (name == "close") {
+        op = MorphologyOp::Close;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* morphology_op_name(MorphologyOp op) {
+    switch (op) {
+        case MorphologyOp::None: return "none";
+        case MorphologyOp::Erode: return "erode";
+        case MorphologyOp::Dilate: return "dilate";
+        case MorphologyOp::Open: return "open";
+        case MorphologyOp::Close: return "close";
+    }
+    return "unknown";
+}
+
+bool parse_structuring_element(const std::string &value, int &width, int &height) {
+    try {
+        const size_t x = value.find_first_of("xX");
+        size_t used = 0;
+        const int w = std::stoi(value.substr(0, x), &used);
+        if (used != (x == std::string::npos ? value.size() : x)) return false;
+        int h = w;
+        if (x != std::string::npos) {
+            const std::string rest = value.substr(x + 1);
+            h = std::stoi(rest, &used);
+            if (used != rest.size()) return false;
+        }
+        if (w < 1 || h < 1 || w > MAX_SE_SIZE || h > MAX_SE_SIZE) return false;
+        width = w;
+        height = h;
+        return true;
+    } catch (const std::exception &) {
+        return false;
+    }
+}
+
+// Mask of the valid pixels in the last word of a row
+static uint64_t tail_mask(int width) {
+    const int bits = width % 64;
+    return bits == 0 ? ~uint64_t{0} : (uint64_t{1} << bits) - 1;
+}
+
+/**
+ * Packs a 0/255 image into one bit per pixel. Pixels below 128 (ink) become 1,
+ * the unused bits of the last word of each row stay 0.
+ *
+ * @param binary Input image (width x height, one channel).
+ * @param packed Output bit plane, resized as needed.
+ */
+void pack_binary(const unsigned char *binary, int width, int height, PackedBinaryImage &packed) {
+    packed.width = width;
+    packed.height = height;
+    packed.words_per_row = (width + 63) / 64;
+    packed.bits.assign(static_cast<size_t>(packed.words_per_row) * height, 0);
+
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < height; ++y) {
+        const unsigned char *src = binary + static_cast<size_t>(y) * width;
+        uint64_t *dst = packed.row(y);
+        for (int j = 0; j < packed.words_per_row; ++j) {
+            const int x0 = j * 64;
+            const int n = std::min(64, width - x0);
+            uint64_t word = 0;
+            for (int b = 0; b < n; ++b) {
+                word |= static_cast<uint64_t>(src[x0 + b] < 128) << b;
+            }
+            dst[j] = word;
+        }
+    }
+}
+
+/**
+ * Expands a bit plane back into a 0/255 image (ink = 0, background = 255).
+ */
+void unpack_binary(const PackedBinaryImage &packed, unsigned char *binary) {
+    const int width = packed.width;
+
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < packed.height; ++y) {
+        const uint64_t *src = packed.row(y);
+        unsigned char *dst = binary + static_cast<size_t>(y) * width;
+        for (int j = 0; j < packed.words_per_row; ++j) {
+            const int x0 = j * 64;
+            const int n = std::min(64, width - x0);
+            const uint64_t word = src[j];
+            for (int b = 0; b < n; ++b) {
+                dst[x0 + b] = ((word >> b) & 1) ? 0 : 255;
+            }
+        }
+    }
+}
+
+/**
+ * Word-parallel row operations. The row is kept in a buffer with `pad` guard
+ * words on each side, initialised with the neutral element of the operation
+ * (all ones for erosion, all zeros for dilation), so pixels outside the image do
+ * not affect the result. Combining steps also update the left guard words:
+ * their partial results are needed once the row is shifted back to centre the
+ * structuring element.
+ */
+class PackedRow {
+public:
+    PackedRow(int words, int max_shift, bool erode)
+        : words_(words), pad_(max_shift / 64 + 2), fill_(erode ? ~uint64_t{0} : 0), erode_(erode),
+          buffer_(words + 2 * pad_), shifted_(words + pad_) {}
+
+    // Loads a row; bits beyond the image width take the neutral value
+    void load(const uint64_t *src, uint64_t tail) {
+        std::fill(buffer_.begin(), buffer_.end(), fill_);
+        std::copy(src, src + words_, data());
+        data()[words_ - 1] = (data()[words_ - 1] & tail) | (fill_ & ~tail);
+    }
+
+    // Stores the row with the bits beyond the image width cleared
+    void store(uint64_t *dst, uint64_t tail) const {
+        std::copy(data(), data() + words_, dst);
+        dst[words_ - 1] &= tail;
+    }
+
+    // row(x) = row(x) op row(x + s) for 0 < s < 64 * (pad - 1), op = AND for erosion, OR for dilation
+    void combine_shifted(int s) {
+        const int count = pad_ + words_; // left guard words and the row itself
+        shift(buffer_.data(), s, count);
+        if (erode_) {
+            #pragma omp simd
+            for (int j = 0; j < count; ++j) buffer_[j] &= shifted_[j];
+        } else {
+            #pragma omp simd
+            for (int j = 0; j < count; ++j) buffer_[j] |= shifted_[j];
+        }
+    }
+
+    // row(x) = row(x + s) for the pixels of the row, |s| < 64 * (pad - 1)
+    void shift_in_place(int s) {
+        shift(data(), s, words_);
+        std::copy(shifted_.begin(), shifted_.begin() + words_, data());
+    }
+
+private:
+    uint64_t *data() { return buffer_.data() + pad_; }
+    const uint64_t *data() const { return buffer_.data() + pad_; }
+
+    // shifted(x) = first(x + s) for the first `count` words starting at `first`
+    void shift(const uint64_t *first, int s, int count) {
+        const int q = (s >= 0) ? s / 64 : -((-s + 63) / 64); // floor(s / 64)
+        const int r = s - 64 * q;
+        const uint64_t *src = first + q;
+        if (r == 0) {
+            std::copy(src, src + count, shifted_.begin());
+        } else {
+            #pragma omp simd
+            for (int j = 0; j < count; ++j) {
+                shifted_[j] = (src[j] >> r) | (src[j + 1] << (64 - r));
+            }
+        }
+    }
+
+    int words_;
+    int pad_;
+    uint64_t fill_;
+    bool erode_;
+    std::vector<uint64_t> buffer_;
+    std::vector<uint64_t> shifted_;
+};
+
+/**
+ * Erosion or dilation with a width x height rectangle, decomposed into a
+ * horizontal line followed by a vertical line. Erosion anchors the rectangle
+ * at (width / 2, height / 2); dilation uses the reflected rectangle, anchored at
+ * ((width - 1) / 2, (height - 1) / 2). For even sizes the two anchors differ,
+ * and only this pairing keeps open and close from shifting the image.
+ *
+ * Horizontal pass: the line of length width is built by doubling, i.e.
+ * row &= row >> 1, row &= row >> 2, ... and one final shift for the rest, so
+ * each row costs O(log width) word operations. Vertical pass: every output word
+ * combines the words of the height rows above and below. Both passes run over
+ * row bands in parallel.
+ */
+static void morph_packed(PackedBinaryImage &image, int se_width, int se_height, bool erode) {
+    const int width = image.width;
+    const int height = image.height;
+    const int words = image.words_per_row;
+    if (width == 0 || height == 0) return;
+
+    const uint64_t tail = tail_mask(width);
+    const int bands = (height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+
+    // Pixels of the rectangle left of and above the anchor
+    const int left = erode ? se_width / 2 : (se_width - 1) / 2;
+    const int above = erode ? se_height / 2 : (se_height - 1) / 2;
+
+    // Horizontal line
+    if (se_width > 1) {
+        #pragma omp parallel
+        {
+            PackedRow row(words, se_width, erode);
+
+            #pragma omp for schedule(static)
+            for (int band = 0; band < bands; ++band) {
+                for (int y = band * BAND_HEIGHT; y < std::min(height, (band + 1) * BAND_HEIGHT); ++y) {
+                    row.load(image.row(y), tail);
+                    int covered = 1; // row(x) now combines pixels x .. x + covered - 1
+                    while (2 * covered <= se_width) {
+                        row.combine_shifted(covered);
+                        covered *= 2;
+                    }
+                    if (covered < se_width) {
+                        row.combine_shifted(se_width - covered);
+                    }
+                    row.shift_in_place(-left);
+                    row.store(image.row(y), tail);
+                }
+            }
+        }
+    }
+
+    // Vertical line; pixels outside the image are neutral, so the row range is clipped
+    if (se_height > 1) {
+        const std::vector<uint64_t> source = image.bits;
+        const int below = se_height - 1 - above;
+
+        #pragma omp parallel for schedule(static)
+        for (int band = 0; band < bands; ++band) {
+            for (int y = band * BAND_HEIGHT; y < std::min(height, (band + 1) * BAND_HEIGHT); ++y) {
+                const int y_first = std::max(0, y - above);
+                const int y_last = std::min(height - 1, y + below);
+                uint64_t *dst = image.row(y);
+                std::copy(source.begin() + static_cast<size_t>(y_first) * words,
+                          source.begin() + static_cast<size_t>(y_first + 1) * words, dst);
+                for (int yy = y_first + 1; yy <= y_last; ++yy) {
+                    const uint64_t *src = source.data() + static_cast<size_t>(yy) * words;
+                    if (erode) {
+                        #pragma omp simd
+                        for (int j = 0; j < words; ++j) dst[j] &= src[j];
+                    } else {
+                        #pragma omp simd
+                        for (int j = 0; j < words; ++j) dst[j] |= src[j];
+                    }
+                }
+            }
+        }
+    }
+}
+
+void erode_packed(PackedBinaryImage &image, int se_width, int se_height) {
+    morph_packed(image, se_width, se_height, true);
+}
+
+void dilate_packed(PackedBinaryImage &image, int se_width, int se_height) {
+    morph_packed(image, se_width, se_height, false);
+}
+
+// true if every ink pixel of inner is also ink in outer (bit planes of the same size)
+static bool is_subset(const std::vector<uint64_t> &inner, const std::vector<uint64_t> &outer) {
+    const int64_t words = static_cast<int64_t>(inner.size());
+    int64_t outside = 0;
+    #pragma omp parallel for simd reduction(+:outside)
+    for (int64_t i = 0; i < words; ++i) {
+        outside += (inner[i] & ~outer[i]) != 0;
+    }
+    return outside == 0;
+}
+
+/**
+ * Applies a morphological operation to a bit plane in place.
+ *
+ * @param image Bit plane, 1 = ink.
+ * @param spec Operation and structuring element size.
+ */
+void apply_morphology(PackedBinaryImage &image, const MorphologySpec &spec) {
+    // Open may only remove ink and close may only add it; the input is kept to check that
+    // (one bit per pixel, cheap next to the operation itself)
+    std::vector<uint64_t> input;
+    if (spec.op == MorphologyOp::Open || spec.op == MorphologyOp::Close) {
+        input = image.bits;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    switch (spec.op) {
+        case MorphologyOp::Erode:
+            erode_packed(image, spec.width, spec.height);
+            break;
+        case MorphologyOp::Dilate:
+            dilate_packed(image, spec.width, spec.height);
+            break;
+        case MorphologyOp::Open:
+            erode_packed(image, spec.width, spec.height);
+            dilate_packed(image, spec.width, spec.height);
+            break;
+        case MorphologyOp::Close:
+            dilate_packed(image, spec.width, spec.height);
+            erode_packed(image, spec.width, spec.height);
+            break;
+        case MorphologyOp::None:
+            return;
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<float> duration = end - start;
+    spdlog::info("Morphology {} {}x{} completed in {} seconds.",
+                 morphology_op_name(spec.op), spec.width, spec.height, duration.count());
+
+    const bool ordered = spec.op == MorphologyOp::Open ? is_subset(image.bits, input)
+                       : spec.op == MorphologyOp::Close ? is_subset(input, image.bits) : true;
+    if (!ordered) {
+        spdlog::error("Morphology {} {}x{} is not {} its input", morphology_op_name(spec.op), spec.width, spec.height,
+                      spec.op == MorphologyOp::Open ? "contained in" : "a superset of");
+    }
+}
+
+/**
+ * Applies a morphological operation to a binarized image in place. The image
+ * is packed once, processed as bit plane and unpacked again.
+ *
+ * @param binary 0/255 image (width x height, one channel); ink is 0.
+ * @param spec Operation and structuring element size.
+ */
+void apply_morphology(unsigned char *binary, int width, int height, const MorphologySpec &spec) {
+    if (spec.op == MorphologyOp::None) return;
+
+    PackedBinaryImage packed;
+    pack_binary(binary, width, height, packed);
+    apply_morphology(packed, spec);
+    unpack_binary(packed, binary);
+}
@@ -0,0 +1,57 @@
+#include <binarization/postprocessing.h>
+#include <binarization/connected_components.h>
+#include <utils/image_io.h>
+#include <utils/perf_report.h>
+#include <filesystem>
+#include <spdlog/spdlog.h>
+
+std::string component_stats_path(const std::string &output_path) {
+    std::filesystem::path p(output_path);
+    return (p.parent_path() / (p.stem().string() + "_components.csv")).string();
+}
+
+/**
+ * Post-processes a binarized image: morphology on the bit plane, then
+ * connected-component labelling for the statistics file and the area filter.
+ * The image is packed once and only unpacked if morphology changed it.
+ *
+ * @param binary 0/255 image (width x height, one channel); ink is 0.
+ * @param options Enabled post-processing steps.
+ * @param output_path Path of the output image; the statistics file is written next to it.
+ */
+void postprocess_binary(unsigned char *binary, int width, int height, const PostprocessOptions &options,
+                        const std::string &output_path) {
+    const bool morphology = options.morphology.op != MorphologyOp::None;
+    const bool components = options.component_stats || options.min_area > 0;
+    if (!morphology && !components) return;
+
+    PerfStage stage("postprocess", static_cast<int64_t>(width) * height, output_path);
+
+    PackedBinaryImage packed;
+    pack_binary(binary, width, height, packed);
+
+    if (morphology) {
+        apply_morphology(packed, options.morphology);
+        unpack_binary(packed, binary);
+    }
+
+    if (components) {
+        ComponentLabeling labeling;
+        label_components(packed, labeling);
+
+        int removed = 0;
+        if (options.min_area > 0) {
+            removed = remove_small_components(binary, width, labeling, options.min_area);
+        }
+        spdlog::info("Connected components: {} found, {} removed below {} pixels",
+                     labeling.components.size(), removed, options.min_area);
+
+        if (options.component_stats && is_stdio_path(output_path)) {
+            spdlog::warn("Component statistics need an output file, not written for stdout output");
+        } else if (options.component_stats) {
+            write_component_stats(component_stats_path(output_path), labeling, options.min_area);
+        }
+    }
+
+    spdlog::info("Post-processing completed in {} seconds.", stage.stop());
+}
@@ -0,0 +1,205 @@
+#include <binarization/quality_metrics.h>
+#include <algorithm>
+#include <cmath>
+#include <omp.h>
+
+// DRD weight matrix size and the block size used to count non-uniform blocks (Lu et al. 2004)
+constexpr int DRD_MASK = 5;
+constexpr int DRD_BLOCK = 8;
+// PSNR reported for identical images; the build uses -ffast-math, so no infinities
+constexpr double PSNR_IDENTICAL = 100.0;
+
+/**
+ * One Zhang-Suen sub-iteration: marks every removable ink pixel first and
+ * deletes them afterwards, so all pixels of a pass see the same neighbourhood.
+ *
+ * @param ink Ink mask (1 = ink) with a one-pixel background border.
+ * @param marks Scratch buffer of the same size.
+ * @param stride Row length of the padded mask.
+ * @param first true for the first sub-iteration (removes south-east boundary points).
+ * @return Number of removed pixels.
+ */
+static int64_t thinning_pass(std::vector<uint8_t> &ink, std::vector<uint8_t> &marks,
+                             int width, int height, int stride, bool first) {
+    int64_t removed = 0;
+
+    #pragma omp parallel for reduction(+:removed) schedule(static)
+    for (int y = 1; y <= height; ++y) {
+        for (int x = 1; x <= width; ++x) {
+            const size_t i = static_cast<size_t>(y) * stride + x;
+            marks[i] = 0;
+            if (!ink[i]) continue;
+
+            // Neighbours P2..P9 clockwise, starting north
+            const uint8_t p[8] = {ink[i - stride], ink[i - stride + 1], ink[i + 1], ink[i + stride + 1],
+                                  ink[i + stride], ink[i + stride - 1], ink[i - 1], ink[i - stride - 1]};
+            int neighbours = 0, transitions = 0;
+            for (int n = 0; n < 8; ++n) {
+                neighbours += p[n];
+                transitions += (!p[n] && p[(n + 1) % 8]);
+            }
+            if (neighbours < 2 || neighbours > 6 || transitions != 1) continue;
+
+            const bool removable = first ? (!(p[0] && p[2] && p[4]) && !(p[2] && p[4] && p[6]))
+                                         : (!(p[0] && p[2] && p[6]) && !(p[0] && p[4] && p[6]));
+            if (removable) {
+                marks[i] = 1;
+                ++removed;
+            }
+        }
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (int64_t i = 0; i < static_cast<int64_t>(ink.size()); ++i) {
+        if (marks[i]) ink[i] = 0;
+    }
+    return removed;
+}
+
+/**
+ * Thins the ink (pixel value 0) of a binary image to a one-pixel-wide
+ * skeleton with the Zhang-Suen algorithm.
+ *
+ * @param binary 0/255 image.
+ * @param skeleton Output mask, 1 = skeleton pixel.
+ */
+void skeletonize(const unsigned char *binary, int width, int height, std::vector<uint8_t> &skeleton) {
+    const int stride = width + 2;
+    std::vector<uint8_t> ink(static_cast<size_t>(stride) * (height + 2), 0);
+    std::vector<uint8_t> marks(ink.size(), 0);
+
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            ink[static_cast<size_t>(y + 1) * stride + x + 1] = binary[static_cast<size_t>(y) * width + x] == 0;
+        }
+    }
+
+    // The two sub-iterations must run in this order, so they are separate statements
+    while (true) {
+        const int64_t first = thinning_pass(ink, marks, width, height, stride, true);
+        const int64_t second = thinning_pass(ink, marks, width, height, stride, false);
+        if (first + second == 0) break;
+    }
+
+    skeleton.resize(static_cast<size_t>(width) * height);
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            skeleton[static_cast<size_t>(y) * width + x] = ink[static_cast<size_t>(y + 1) * stride + x + 1];
+        }
+    }
+}
+
+/**
+ * Number of DRD_BLOCK x DRD_BLOCK blocks of the ground truth that contain both
+ * ink and background (blocks at the right and bottom edge may be smaller).
+ */
+static int64_t non_uniform_blocks(const unsigned char *ground_truth, int width, int height) {
+    const int blocks_x = (width + DRD_BLOCK - 1) / DRD_BLOCK;
+    const int blocks_y = (height + DRD_BLOCK - 1) / DRD_BLOCK;
+    int64_t count = 0;
+
+    #pragma omp parallel for reduction(+:count) schedule(static)
+    for (int by = 0; by < blocks_y; ++by) {
+        for (int bx = 0; bx < blocks_x; ++bx) {
+            bool ink = false, background = false;
+            for (int y = by * DRD_BLOCK; y < std::min(height, (by + 1) * DRD_BLOCK); ++y) {
+                for (int x = bx * DRD_BLOCK; x < std::min(width, (bx + 1) * DRD_BLOCK); ++x) {
+                    (ground_truth[static_cast<size_t>(y) * width + x] == 0 ? ink : background) = true;
+                }
+            }
+            count += ink && background;
+        }
+    }
+    return count;
+}
+
+/**
+ * Compares a binarization with its ground truth using the DIBCO measures:
+ * - F-measure from pixel precision and recall of the ink;
+ * - pseudo-F-measure, whose recall counts only the ground-truth skeleton, so
+ *   a result is not penalized for strokes that are slightly thinner;
+ * - PSNR with the foreground/background difference as signal (C = 1),
+ *   PSNR_IDENTICAL for a perfect result;
+ * - DRD, every flipped pixel weighted by the ground truth in its 5x5
+ *   neighbourhood (reciprocal distance), normalized by the non-uniform 8x8 blocks.
+ *
+ * @param result Binarization to evaluate (0/255, 0 = ink).
+ * @param ground_truth Reference of the same size (0/255, 0 = ink).
+ * @return All measures; precision, recall and F-measures in percent.
+ */
+QualityMetrics evaluate_binarization(const unsigned char *result, const unsigned char *ground_truth,
+                                     int width, int height) {
+    const int64_t pixels = static_cast<int64_t>(width) * height;
+
+    // Normalized reciprocal-distance weights, centre 0
+    double weights[DRD_MASK][DRD_MASK];
+    const int centre = DRD_MASK / 2;
+    double weight_sum = 0.0;
+    for (int i = 0; i < DRD_MASK; ++i) {
+        for (int j = 0; j < DRD_MASK; ++j) {
+            const int di = i - centre, dj = j - centre;
+            weights[i][j] = (di == 0 && dj == 0) ? 0.0 : 1.0 / std::sqrt(static_cast<double>(di * di + dj * dj));
+            weight_sum += weights[i][j];
+        }
+    }
+    for (auto &row : weights) {
+        for (double &w : row) w /= weight_sum;
+    }
+
+    std::vector<uint8_t> skeleton;
+    skeletonize(ground_truth, width, height, skeleton);
+
+    int64_t true_positive = 0, false_positive = 0, false_negative = 0;
+    int64_t skeleton_pixels = 0, skeleton_hits = 0;
+    double drd_sum = 0.0;
+
+    #pragma omp parallel for reduction(+:true_positive, false_positive, false_negative, skeleton_pixels, skeleton_hits, drd_sum) schedule(static)
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const size_t i = static_cast<size_t>(y) * width + x;
+            const bool ink = result[i] == 0;
+            const bool truth = ground_truth[i] == 0;
+            true_positive += ink && truth;
+            false_positive += ink && !truth;
+            false_negative += !ink && truth;
+            skeleton_pixels += skeleton[i];
+            skeleton_hits += skeleton[i] && ink;
+
+            if (ink == truth) continue;
+            // Distortion of a flipped pixel: ground-truth pixels around it that differ from its new value
+            double distortion = 0.0;
+            for (int dy = -centre; dy <= centre; ++dy) {
+                const int yy = y + dy;
+                if (yy < 0 || yy >= height) continue;
+                for (int dx = -centre; dx <= centre; ++dx) {
+                    const int xx = x + dx;
+                    if (xx < 0 || xx >= width) continue;
+                    const bool neighbour_truth = ground_truth[static_cast<size_t>(yy) * width + xx] == 0;
+                    if (neighbour_truth != ink) distortion += weights[dy + centre][dx + centre];
+                }
+            }
+            drd_sum += distortion;
+        }
+    }
+
+    QualityMetrics metrics;
+    auto percent = [](int64_t part, int64_t total) {
+        return total > 0 ? 100.0 * static_cast<double>(part) / total : 0.0;
+    };
+    auto harmonic = [](double a, double b) { return a + b > 0.0 ? 2.0 * a * b / (a + b) : 0.0; };
+
+    metrics.precision = percent(true_positive, true_positive + false_positive);
+    metrics.recall = percent(true_positive, true_positive + false_negative);
+    metrics.f_measure = harmonic(metrics.precision, metrics.recall);
+    metrics.pseudo_recall = percent(skeleton_hits, skeleton_pixels);
+    metrics.pseudo_f_measure = harmonic(metrics.precision, metrics.pseudo_recall);
+
+    const double mse = static_cast<double>(false_positive + false_negative) / std::max<int64_t>(1, pixels);
+    metrics.psnr = mse > 0.0 ? 10.0 * std::log10(1.0 / mse) : PSNR_IDENTICAL;
+
+    const int64_t blocks = non_uniform_blocks(ground_truth, width, height);
+    metrics.drd = drd_sum / std::max<int64_t>(1, blocks);
+    return metrics;
+}
@@ -1,34 +1,84 @@
 #include <binarization/thresholding.h>
 #include <utils/image_io.h>
+#include <utils/plane_arena.h>
+#include <utils/perf_report.h>
+#include <utils/pixel_traits.h>
 #include <filesystem>
-#include <chrono>
 #include <omp.h>
 #include <stb_image.h>
 #include <stb_image_write.h>
 #include <spdlog/spdlog.h>
+
 /**
- * @brief Performs sequential image binarization using a threshold.
+ * Converts pixel i of an interleaved image to binary and writes the result to
+ * all channels; an alpha channel is set to fully opaque.
  *
- * This function reads an image from the specified input path, applies
- * a simple thresholding operation to convert it into a binary image,
- * and saves the result to the output path.
- *
- * @param input_path Path to the input image file.
- * @param output_path Path where the output image will be saved. If empty, a default path is generated.
- * @param threshold The threshold value for binarization (0-255).
+ * @param threshold Threshold in the value range of Pixel.
  */
-void binarize_image(const std::string &input_path, std::string output_path, int threshold) {
-    spdlog::info("Starting sequential binarization with threshold {} for: {}", threshold, input_path);
+template <typename Pixel>
+static inline void threshold_pixel(const Pixel *image, unsigned char *out, int i, int channels, int threshold) {
+    int idx = i * channels;
 
-    // Variables to store image properties
-    int width, height, channels;
+    // Compute grayscale luminance using standard weights (gray images: first channel)
+    Pixel lum = channels < 3 ? image[idx] : static_cast<Pixel>(
+        0.2126f * image[idx] + 0.7152f * image[idx + 1] + 0.0722f * image[idx + 2]
+    );
 
-    // Load the image from the input file
-    unsigned char *image = stbi_load(input_path.c_str(), &width, &height, &channels, 0);
-    if (!image) {
-        spdlog::error("Failed to load image: {}", input_path);
-        return;
+    // Convert to binary: 255 for above threshold, 0 for below
+    unsigned char binary = (lum > threshold) ? 255 : 0;
+
+    // Assign the binary value to all channels (grayscale effect)
+    for (int c = 0; c < channels; c++) {
+        out[idx + c] = binary;
+    }
+    // If there's an alpha channel, preserve it at full opacity
+    if (channels == 4) {
+        out[idx + 3] = 255; // Always set alpha to fully opaque
+    }
+}
+
+/**
+ * Thresholds an interleaved image sequentially or with OpenMP.
+ *
+ * @param threshold Threshold in the value range of Pixel.
+ */
+template <typename Pixel>
+static void threshold_pixels(const Pixel *image, unsigned char *out, int pixels, int channels,
+                             int threshold, bool parallel) {
+    if (parallel) {
+        // Parallel loop using OpenMP to speed up computation
+#pragma omp parallel for simd
+        for (int i = 0; i < pixels; i++) {
+            threshold_pixel(image, out, i, channels, threshold);
+        }
+    } else {
+        // Iterate through each pixel and apply thresholding
+        for (int i = 0; i < pixels; i++) {
+            threshold_pixel(image, out, i, channels, threshold);
+        }
     }
+}
+
+void binarize_pixels(const unsigned char *image, unsigned char *out, int pixels, int channels,
+                     int threshold, bool parallel) {
+    threshold_pixels(image, out, pixels, channels, threshold, parallel);
+}
+
+/**
+ * Thresholds an already decoded image sequentially or with OpenMP and writes
+ * the binary result. The 8-bit threshold is scaled to the pixel range, so a
+ * 16-bit image is compared against threshold * 257.
+ *
+ * @param input_path Path of the decoded image (names the output if output_path is empty).
+ * @param output_path Path where the output image will be saved. If empty, a default path is generated.
+ * @param image Interleaved image (width x height x channels).
+ * @param threshold The threshold value for binarization (0-255).
+ * @param parallel Whether the pixel loop runs in parallel.
+ */
+template <typename Pixel>
+void binarize_decoded_image(const std::string &input_path, std::string output_path, const Pixel *image,
+                            int width, int height, int channels, int threshold, bool parallel) {
+    const char *mode = parallel ? "Parallel" : "Sequential";
 
     // If no output path is specified, generate one automatically
     if (output_path.empty()) {
@@ -36,119 +86,93 @@ void binarize_image(const std::string &input_path, std::string output_path, int
     }
 
     // Create an output buffer for the binarized image
-    std::vector<unsigned char> out(width * height * channels);
-
-    // Start measuring the execution time
-    auto start = std::chrono::high_resolution_clock::now();
+    Plane<unsigned char> out(static_cast<size_t>(width) * height * channels);
+    const int pixel_threshold = threshold * static_cast<int>(PixelTraits<Pixel>::max_value / 255);
 
-    // Iterate through each pixel and apply thresholding
-    for (int i = 0; i < width * height; i++) {
-        int idx = i * channels;
-
-        // Compute grayscale luminance using standard weights
-        unsigned char lum = static_cast<unsigned char>(
-            0.2126f * image[idx] + 0.7152f * image[idx + 1] + 0.0722f * image[idx + 2]
-        );
-
-        // Convert to binary: 255 for above threshold, 0 for below
-        unsigned char binary = (lum > threshold) ? 255 : 0;
-
-        // Assign the binary value to all channels (grayscale effect)
-        for (int c = 0; c < channels; c++) {
-            out[idx + c] = binary;
-        }
-        // If there's an alpha channel, preserve it at full opacity
-        if (channels == 4) {
-            out[idx + 3] = 255; // Always set alpha to fully opaque
-        }
-    }
-
-    // Stop measuring execution time
-    auto end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<float> duration = end - start;
-    spdlog::info("Sequential binarization completed in {} seconds.", duration.count());
+    // Measure the thresholding pass only; loading and writing are separate stages
+    PerfStage stage("threshold", static_cast<int64_t>(width) * height);
+    threshold_pixels(image, out.data(), width * height, channels, pixel_threshold, parallel);
+    spdlog::info("{} binarization completed in {} seconds.", mode, stage.stop());
 
     // Write the output image
     if (!write_binary_image(output_path, width, height, channels, out.data())) {
-        spdlog::error("Failed to write binarized image: {}", output_path);
+        spdlog::error("Failed to write {} binarized image: {}", mode, output_path);
     } else {
-        spdlog::info("Binarized image saved to: {}", output_path);
+        spdlog::info("{} binarized image saved to: {}", mode, output_path);
     }
-
-    // Free memory allocated for the input image
-    stbi_image_free(image);
 }
 
+template void binarize_decoded_image<uint8_t>(const std::string &, std::string, const uint8_t *, int, int, int, int, bool);
+template void binarize_decoded_image<uint16_t>(const std::string &, std::string, const uint16_t *, int, int, int, int, bool);
+
 /**
- * @brief Performs parallel image binarization using OpenMP.
- *
- * This function reads an image from the specified input path, applies
- * a thresholding operation in parallel using OpenMP, and saves the
- * binarized image to the output path.
+ * Loads an image with Pixel samples and thresholds it sequentially or with OpenMP.
  *
  * @param input_path Path to the input image file.
  * @param output_path Path where the output image will be saved. If empty, a default path is generated.
  * @param threshold The threshold value for binarization (0-255).
+ * @param parallel Whether the pixel loop runs in parallel.
  */
-void binarize_image_parallel(const std::string &input_path, std::string output_path, int threshold) {
-    spdlog::info("Starting parallel binarization with threshold {} for: {}", threshold, input_path);
+template <typename Pixel>
+static void threshold_image(const std::string &input_path, std::string output_path, int threshold, bool parallel) {
+    PerfJob job(parallel ? "parallel" : "sequential");
 
     // Variables to store image properties
     int width, height, channels;
 
     // Load the image from the input file
-    unsigned char *image = stbi_load(input_path.c_str(), &width, &height, &channels, 0);
+    Pixel *image = load_image<Pixel>(input_path, width, height, channels);
     if (!image) {
         spdlog::error("Failed to load image: {}", input_path);
         return;
     }
 
-    // If no output path is specified, generate one automatically
-    if (output_path.empty()) {
-        output_path = make_output_path(input_path, "");
-    }
-
-    // Create an output buffer for the binarized image
-    std::vector<unsigned char> out(width * height * channels);
-
-    // Start measuring the execution time
-    auto start = std::chrono::high_resolution_clock::now();
+    binarize_decoded_image(input_path, output_path, image, width, height, channels, threshold, parallel);
 
-    // Parallel loop using OpenMP to speed up computation
-#pragma omp parallel for simd
-    for (int i = 0; i < width * height; i++) {
-        int idx = i * channels;
-
-        // Compute grayscale luminance using standard weights
-        unsigned char lum = static_cast<unsigned char>(
-            0.2126f * image[idx] + 0.7152f * image[idx + 1] + 0.0722f * image[idx + 2]
-        );
+    // Free memory allocated for the input image
+    stbi_image_free(image);
+}
 
-        // Convert to binary: 255 for above threshold, 0 for below
-        unsigned char binary = (lum > threshold) ? 255 : 0;
+/**
+ * @brief Performs sequential image binarization using a threshold.
+ *
+ * This function reads an image from the specified input path, applies
+ * a simple thresholding operation to convert it into a binary image,
+ * and saves the result to the output path. 16-bit images are thresholded
+ * at full precision.
+ *
+ * @param input_path Path to the input image file.
+ * @param output_path Path where the output image will be saved. If empty, a default path is generated.
+ * @param threshold The threshold value for binarization (0-255).
+ */
+void binarize_image(const std::string &input_path, std::string output_path, int threshold) {
+    spdlog::info("Starting sequential binarization with threshold {} for: {}", threshold, input_path);
 
-        // Assign the binary value to all channels (grayscale effect)
-        for (int c = 0; c < channels; c++) {
-            out[idx + c] = binary;
-        }
-        // If there's an alpha channel, preserve it at full opacity
-        if (channels == 4) {
-            out[idx + 3] = 255; // Always set alpha to fully opaque
-        }
+    if (is_16bit_image(input_path)) {
+        threshold_image<uint16_t>(input_path, output_path, threshold, false);
+    } else {
+        threshold_image<uint8_t>(input_path, output_path, threshold, false);
     }
+}
 
-    // Stop measuring execution time
-    auto end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<float> duration = end - start;
-    spdlog::info("Parallel binarization completed in {} seconds.", duration.count());
+/**
+ * @brief Performs parallel image binarization using OpenMP.
+ *
+ * This function reads an image from the specified input path, applies
+ * a thresholding operation in parallel using OpenMP, and saves the
+ * binarized image to the output path. 16-bit images are thresholded
+ * at full precision.
+ *
+ * @param input_path Path to the input image file.
+ * @param output_path Path where the output image will be saved. If empty, a default path is generated.
+ * @param threshold The threshold value for binarization (0-255).
+ */
+void binarize_image_parallel(const std::string &input_path, std::string output_path, int threshold) {
+    spdlog::info("Starting parallel binarization with threshold {} for: {}", threshold, input_path);
 
-    // Write the output image
-    if (!write_binary_image(output_path, width, height, channels, out.data())) {
-        spdlog::error("Failed to write parallel binarized image: {}", output_path);
+    if (is_16bit_image(input_path)) {
+        threshold_image<uint16_t>(input_path, output_path, threshold, true);
     } else {
-        spdlog::info("Parallel binarized image saved to: {}", output_path);
+        threshold_image<uint8_t>(input_path, output_path, threshold, true);
     }
-
-    // Free memory allocated for the input image
-    stbi_image_free(image);
 }
\ No newline at end of file
@@ -0,0 +1,473 @@
+#include <binarization/thresholding.h>
+#include <binarization/adaptive_thresholding.h>
+#include <binarization/integral_binarization.h>
+#include <binarization/integral_image.h>
+#include <binarization/quality_metrics.h>
+#include <utils/image_io.h>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <omp.h>
+#include <stb_image.h>
+#include <spdlog/spdlog.h>
+
+// Accuracy-vs-throughput evaluation: runs every method and parameter set over a
+// directory of image / ground-truth pairs (DIBCO layout), measures F-measure,
+// pseudo-F-measure, PSNR and DRD together with the kernel throughput and marks
+// the configurations on the Pareto front of quality and speed.
+
+namespace fs = std::filesystem;
+
+struct EvalConfig {
+    std::string dataset_dir;
+    std::string ground_truth_dir;  // empty: <name>_gt.<ext> next to the image
+    std::vector<std::string> methods = {"global", "sauvola", "nick", "integral_sauvola", "integral_nick"};
+    std::vector<int> windows = {15, 31};
+    std::vector<float> ks = {0.2f};
+    std::vector<int> thresholds = {128};
+    float R = 128.0f;
+    int repetitions = 3;
+    std::string csv_path = "evaluation_results.csv";
+    std::string details_path = "evaluation_per_image.csv";
+};
+
+// One image with its ground truth, both as 0/255 planes of the same size
+struct EvalImage {
+    std::string name;
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> gray;
+    std::vector<unsigned char> ground_truth;
+};
+
+// One method with one parameter set; out receives a 0/255 plane
+struct Candidate {
+    std::string method;
+    std::string params;
+    std::function<void(const EvalImage &, IntegralImage &, unsigned char *)> run;
+};
+
+struct ImageResult {
+    std::string image;
+    size_t candidate;
+    QualityMetrics metrics;
+    double seconds;  // median of the timed runs
+};
+
+// Mean quality and total throughput of one candidate over the dataset
+struct Summary {
+    std::string method;
+    std::string params;
+    int images = 0;
+    QualityMetrics mean;
+    double seconds = 0.0;
+    double megapixels = 0.0;
+    bool pareto = false;
+
+    double mpix_per_second() const { return seconds > 0.0 ? megapixels / seconds : 0.0; }
+};
+
+bool is_image_file(const fs::path &path) {
+    static const char *extensions[] = {".png", ".bmp", ".jpg", ".jpeg", ".pgm", ".ppm", ".pnm", ".tga"};
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return std::find(std::begin(extensions), std::end(extensions), ext) != std::end(extensions);
+}
+
+bool is_ground_truth_name(const std::string &stem) {
+    std::string lower = stem;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    return lower.size() > 3 && lower.compare(lower.size() - 3, 3, "_gt") == 0;
+}
+
+/**
+ * Finds the image / ground-truth pairs of a dataset. Ground truths are either
+ * <stem>_gt.<ext> (or _GT) next to the image, or <stem>.<ext> in a separate
+ * directory; the extension may differ from the image.
+ *
+ * @return Pairs (name, image path, ground-truth path) sorted by name.
+ */
+std::vector<std::array<std::string, 3>> find_pairs(const EvalConfig &config) {
+    std::map<std::string, std::string> images, truths;
+    for (const auto &entry : fs::directory_iterator(config.dataset_dir)) {
+        if (!entry.is_regular_file() || !is_image_file(entry.path())) continue;
+        const std::string stem = entry.path().stem().string();
+        if (is_ground_truth_name(stem)) {
+            if (config.ground_truth_dir.empty()) truths[stem.substr(0, stem.size() - 3)] = entry.path().string();
+        } else {
+            images[stem] = entry.path().string();
+        }
+    }
+    if (!config.ground_truth_dir.empty()) {
+        for (const auto &entry : fs::directory_iterator(config.ground_truth_dir)) {
+            if (!entry.is_regular_file() || !is_image_file(entry.path())) continue;
+            std::string stem = entry.path().stem().string();
+            if (is_ground_truth_name(stem)) stem = stem.substr(0, stem.size() - 3);
+            truths[stem] = entry.path().string();
+        }
+    }
+
+    std::vector<std::array<std::string, 3>> pairs;
+    for (const auto &[stem, path] : images) {
+        const auto truth = truths.find(stem);
+        if (truth == truths.end()) {
+            std::cout << "  skip " << stem << " (no ground truth)" << std::endl;
+            continue;
+        }
+        pairs.push_back({stem, path, truth->second});
+    }
+    return pairs;
+}
+
+/**
+ * Loads an image as gray plane and its ground truth as 0/255 plane (ink where
+ * the reference is darker than 128).
+ *
+ * @return false if a file could not be read or the sizes differ.
+ */
+bool load_pair(const std::array<std::string, 3> &pair, EvalImage &image) {
+    int channels;
+    unsigned char *pixels = load_image<unsigned char>(pair[1], image.width, image.height, channels);
+    if (!pixels) {
+        std::cerr << "Failed to load image: " << pair[1] << std::endl;
+        return false;
+    }
+    const size_t count = static_cast<size_t>(image.width) * image.height;
+    image.name = pair[0];
+    image.gray.resize(count);
+    convert_to_grayscale(pixels, channels, image.gray.data(), count);
+    stbi_image_free(pixels);
+
+    int width, height;
+    unsigned char *truth = stbi_load(pair[2].c_str(), &width, &height, &channels, 1);
+    if (!truth) {
+        std::cerr << "Failed to load ground truth: " << pair[2] << std::endl;
+        return false;
+    }
+    if (width != image.width || height != image.height) {
+        std::cerr << "Ground truth size differs from image: " << pair[2] << std::endl;
+        stbi_image_free(truth);
+        return false;
+    }
+    image.ground_truth.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        image.ground_truth[i] = truth[i] < 128 ? 0 : 255;
+    }
+    stbi_image_free(truth);
+    return true;
+}
+
+std::string format_float(float value) {
+    std::ostringstream ss;
+    ss << value;
+    return ss.str();
+}
+
+/**
+ * Expands the selected methods over their parameter grids. Integral methods
+ * rebuild the integral image in every run, so their throughput includes it.
+ */
+std::vector<Candidate> make_candidates(const EvalConfig &config) {
+    std::vector<Candidate> candidates;
+    const float R = config.R;
+    for (const std::string &method : config.methods) {
+        if (method == "global") {
+            for (int t : config.thresholds) {
+                candidates.push_back({method, "t=" + std::to_string(t),
+                    [t](const EvalImage &img, IntegralImage &, unsigned char *out) {
+                        binarize_pixels(img.gray.data(), out, img.width * img.height, 1, t, true);
+                    }});
+            }
+            continue;
+        }
+        for (int w : config.windows) {
+            for (float k : config.ks) {
+                const std::string params = "w=" + std::to_string(w) + " k=" + format_float(k);
+                if (method == "sauvola") {
+                    candidates.push_back({method, params, [w, k, R](const EvalImage &img, IntegralImage &, unsigned char *out) {
+                        sauvola_binarize(img.gray.data(), out, img.width, img.height, w, k, R);
+                    }});
+                } else if (method == "nick") {
+                    candidates.push_back({method, params, [w, k](const EvalImage &img, IntegralImage &, unsigned char *out) {
+                        nick_binarize(img.gray.data(), out, img.width, img.height, w, k);
+                    }});
+                } else if (method == "integral_sauvola") {
+                    candidates.push_back({method, params, [w, k, R](const EvalImage &img, IntegralImage &integral, unsigned char *out) {
+                        integral.build(img.gray.data(), img.width, img.height);
+                        sauvola_binarize_integral(integral, img.gray.data(), out, w, k, R);
+                    }});
+                } else if (method == "integral_nick") {
+                    candidates.push_back({method, params, [w, k](const EvalImage &img, IntegralImage &integral, unsigned char *out) {
+                        integral.build(img.gray.data(), img.width, img.height);
+                        nick_binarize_integral(integral, img.gray.data(), out, w, k);
+                    }});
+                } else {
+                    throw std::invalid_argument("unknown method " + method);
+                }
+            }
+        }
+    }
+    return candidates;
+}
+
+/**
+ * Marks every summary that no other summary beats in both F-measure and
+ * throughput (higher is better for both).
+ */
+void mark_pareto_front(std::vector<Summary> &summaries) {
+    for (Summary &a : summaries) {
+        a.pareto = true;
+        for (const Summary &b : summaries) {
+            const bool no_worse = b.mean.f_measure >= a.mean.f_measure && b.mpix_per_second() >= a.mpix_per_second();
+            const bool better = b.mean.f_measure > a.mean.f_measure || b.mpix_per_second() > a.mpix_per_second();
+            if (&a != &b && no_worse && better) {
+                a.pareto = false;
+                break;
+            }
+        }
+    }
+}
+
+std::vector<Summary> summarize(const std::vector<Candidate> &candidates, const std::vector<ImageResult> &results,
+                               const std::map<std::string, double> &megapixels) {
+    std::vector<Summary> summaries(candidates.size());
+    for (size_t c = 0; c < candidates.size(); ++c) {
+        summaries[c].method = candidates[c].method;
+        summaries[c].params = candidates[c].params;
+    }
+    for (const ImageResult &r : results) {
+        Summary &s = summaries[r.candidate];
+        s.images++;
+        s.mean.precision += r.metrics.precision;
+        s.mean.recall += r.metrics.recall;
+        s.mean.f_measure += r.metrics.f_measure;
+        s.mean.pseudo_recall += r.metrics.pseudo_recall;
+        s.mean.pseudo_f_measure += r.metrics.pseudo_f_measure;
+        s.mean.psnr += r.metrics.psnr;
+        s.mean.drd += r.metrics.drd;
+        s.seconds += r.seconds;
+        s.megapixels += megapixels.at(r.image);
+    }
+    for (Summary &s : summaries) {
+        if (s.images == 0) continue;
+        const double n = s.images;
+        s.mean.precision /= n;
+        s.mean.recall /= n;
+        s.mean.f_measure /= n;
+        s.mean.pseudo_recall /= n;
+        s.mean.pseudo_f_measure /= n;
+        s.mean.psnr /= n;
+        s.mean.drd /= n;
+    }
+    mark_pareto_front(summaries);
+    return summaries;
+}
+
+/**
+ * Runs every candidate on every pair: one untimed run whose output is scored,
+ * then `repetitions` timed runs of the kernel alone.
+ */
+std::vector<Summary> evaluate(const EvalConfig &config, const std::vector<Candidate> &candidates,
+                              std::vector<ImageResult> &results) {
+    std::map<std::string, double> megapixels;
+    IntegralImage integral;
+
+    for (const auto &pair : find_pairs(config)) {
+        EvalImage image;
+        if (!load_pair(pair, image)) continue;
+        megapixels[image.name] = static_cast<double>(image.width) * image.height / 1e6;
+        std::vector<unsigned char> out(image.gray.size());
+
+        for (size_t c = 0; c < candidates.size(); ++c) {
+            candidates[c].run(image, integral, out.data());
+            const QualityMetrics metrics = evaluate_binarization(out.data(), image.ground_truth.data(),
+                                                                 image.width, image.height);
+
+            std::vector<double> times;
+            for (int i = 0; i < config.repetitions; ++i) {
+                const double start = omp_get_wtime();
+                candidates[c].run(image, integral, out.data());
+                times.push_back(omp_get_wtime() - start);
+            }
+            std::sort(times.begin(), times.end());
+            results.push_back({image.name, c, metrics, times[times.size() / 2]});
+
+            std::cout << "  " << std::left << std::setw(12) << image.name << std::setw(18) << candidates[c].method
+                      << std::setw(14) << candidates[c].params << std::right << std::fixed << std::setprecision(2)
+                      << " F " << std::setw(6) << metrics.f_measure << "  pF " << std::setw(6) << metrics.pseudo_f_measure
+                      << "  PSNR " << std::setw(6) << metrics.psnr << "  DRD " << std::setw(6) << metrics.drd
+                      << "  " << std::setprecision(1) << megapixels[image.name] / times[times.size() / 2] << " MPix/s"
+                      << std::defaultfloat << std::endl;
+        }
+    }
+    return summarize(candidates, results, megapixels);
+}
+
+bool write_summary_csv(const std::string &path, const std::vector<Summary> &summaries) {
+    std::ofstream csv(path);
+    if (!csv) return false;
+    csv << "Method,Params,Images,FMeasure,PseudoFMeasure,Precision,Recall,PSNR,DRD,MPixPerSecond,Pareto" << std::endl;
+    for (const Summary &s : summaries) {
+        csv << s.method << "," << s.params << "," << s.images << "," << s.mean.f_measure << ","
+            << s.mean.pseudo_f_measure << "," << s.mean.precision << "," << s.mean.recall << "," << s.mean.psnr << ","
+            << s.mean.drd << "," << s.mpix_per_second() << "," << (s.pareto ? 1 : 0) << std::endl;
+    }
+    return true;
+}
+
+bool write_details_csv(const std::string &path, const std::vector<Candidate> &candidates,
+                       const std::vector<ImageResult> &results) {
+    std::ofstream csv(path);
+    if (!csv) return false;
+    csv << "Image,Method,Params,FMeasure,PseudoFMeasure,Precision,Recall,PseudoRecall,PSNR,DRD,Seconds" << std::endl;
+    for (const ImageResult &r : results) {
+        const Candidate &c = candidates[r.candidate];
+        csv << r.image << "," << c.method << "," << c.params << "," << r.metrics.f_measure << ","
+            << r.metrics.pseudo_f_measure << "," << r.metrics.precision << "," << r.metrics.recall << ","
+            << r.metrics.pseudo_recall << "," << r.metrics.psnr << "," << r.metrics.drd << "," << r.seconds << std::endl;
+    }
+    return true;
+}
+
+void print_table(const std::vector<Summary> &summaries) {
+    std::cout << "\n" << std::left << std::setw(18) << "Method" << std::setw(14) << "Params" << std::right
+              << std::setw(8) << "F" << std::setw(8) << "pF" << std::setw(8) << "PSNR" << std::setw(8) << "DRD"
+              << std::setw(10) << "MPix/s" << "  Pareto\n";
+    for (const Summary &s : summaries) {
+        std::cout << std::left << std::setw(18) << s.method << std::setw(14) << s.params << std::right << std::fixed
+                  << std::setprecision(2) << std::setw(8) << s.mean.f_measure << std::setw(8) << s.mean.pseudo_f_measure
+                  << std::setw(8) << s.mean.psnr << std::setw(8) << s.mean.drd << std::setprecision(1)
+                  << std::setw(10) << s.mpix_per_second() << (s.pareto ? "  *" : "") << std::defaultfloat << "\n";
+    }
+
+    // Front from fastest to most accurate
+    std::vector<const Summary *> front;
+    for (const Summary &s : summaries) {
+        if (s.pareto && s.images > 0) front.push_back(&s);
+    }
+    std::sort(front.begin(), front.end(), [](const Summary *a, const Summary *b) {
+        return a->mpix_per_second() > b->mpix_per_second();
+    });
+    std::cout << "\nPareto front (F-measure vs. MPix/s):\n";
+    for (const Summary *s : front) {
+        std::cout << "  " << s->method << " " << s->params << std::fixed << std::setprecision(2)
+                  << "  F " << s->mean.f_measure << "  " << std::setprecision(1) << s->mpix_per_second()
+                  << " MPix/s" << std::defaultfloat << "\n";
+    }
+}
+
+template <typename T>
+std::vector<T> parse_list(const std::string &value, const std::function<T(const std::string &)> &parse) {
+    std::vector<T> list;
+    std::stringstream ss(value);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) list.push_back(parse(item));
+    }
+    if (list.empty()) {
+        throw std::invalid_argument("empty list");
+    }
+    return list;
+}
+
+void printHelp() {
+    std::cout << "Usage: eval_image_processor -d <dataset> [options]\n"
+              << "Options:\n"
+              << "  -d, --dataset <dir>     Images with ground truth <name>_gt.<ext> in the same directory\n"
+              << "  --ground_truth <dir>    Ground truth in a separate directory (<name>.<ext> or <name>_gt.<ext>)\n"
+              << "  --methods <list>        global, sauvola, nick, integral_sauvola, integral_nick (default: all)\n"
+              << "  --windows <list>        Window sizes for Sauvola/Nick (default: 15,31)\n"
+              << "  --k <list>              Values of k for Sauvola/Nick (default: 0.2)\n"
+              << "  --thresholds <list>     Thresholds for global (default: 128)\n"
+              << "  --R <num>               Dynamic range for Sauvola (default: 128)\n"
+              << "  --repetitions <num>     Timed runs per image and configuration (default: 3)\n"
+              << "  --csv <path>            Summary with Pareto flag (default: evaluation_results.csv)\n"
+              << "  --details <path>        Per-image results (default: evaluation_per_image.csv)\n"
+              << "  -h, --help              Show this help message\n";
+}
+
+int main(int argc, char *argv[]) {
+    EvalConfig config;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "-h" || arg == "--help") {
+                printHelp();
+                return 0;
+            }
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << std::endl;
+                return 1;
+            }
+            std::string value = argv[++i];
+            if (arg == "-d" || arg == "--dataset") config.dataset_dir = value;
+            else if (arg == "--ground_truth") config.ground_truth_dir = value;
+            else if (arg == "--methods") config.methods = parse_list<std::string>(value, [](const std::string &s) { return s; });
+            else if (arg == "--windows") config.windows = parse_list<int>(value, [](const std::string &s) { return std::stoi(s); });
+            else if (arg == "--k") config.ks = parse_list<float>(value, [](const std::string &s) { return std::stof(s); });
+            else if (arg == "--thresholds") config.thresholds = parse_list<int>(value, [](const std::string &s) { return std::stoi(s); });
+            else if (arg == "--R") config.R = std::stof(value);
+            else if (arg == "--repetitions") config.repetitions = std::max(1, std::stoi(value));
+            else if (arg == "--csv") config.csv_path = value;
+            else if (arg == "--details") config.details_path = value;
+            else {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                printHelp();
+                return 1;
+            }
+        }
+        for (int w : config.windows) {
+            if (w <= 0 || w % 2 == 0) throw std::invalid_argument("window sizes must be positive and odd");
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Invalid argument: " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (config.dataset_dir.empty() || !fs::is_directory(config.dataset_dir)) {
+        std::cerr << "Dataset directory is required (use --dataset)" << std::endl;
+        printHelp();
+        return 1;
+    }
+
+    // The kernels log every call; keep that out of the measurements
+    spdlog::set_level(spdlog::level::warn);
+
+    std::cout << "Evaluating " << config.dataset_dir << " with " << omp_get_max_threads() << " thread(s)\n";
+
+    std::vector<Candidate> candidates;
+    try {
+        candidates = make_candidates(config);
+    } catch (const std::exception &e) {
+        std::cerr << "Invalid argument: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::vector<ImageResult> results;
+    const std::vector<Summary> summaries = evaluate(config, candidates, results);
+    if (results.empty()) {
+        std::cerr << "No image / ground-truth pairs found in " << config.dataset_dir << std::endl;
+        return 1;
+    }
+
+    print_table(summaries);
+
+    if (!write_summary_csv(config.csv_path, summaries) ||
+        !write_details_csv(config.details_path, candidates, results)) {
+        std::cerr << "Failed to write " << config.csv_path << " or " << config.details_path << std::endl;
+        return 1;
+    }
+    std::cout << "\nResults written to " << config.csv_path << " and " << config.details_path << std::endl;
+    return 0;
+}
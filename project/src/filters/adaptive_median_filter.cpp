@@ -1,8 +1,14 @@
 #include <filters/adaptive_median_filter.h>
 #include <utils/image_io.h>
+#include <utils/plane_arena.h>
+#include <utils/perf_report.h>
+#include <utils/pixel_traits.h>
+#include <utils/trace.h>
 #include <filesystem>
-#include <chrono>
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
 #include <omp.h>
 #include <stb_image.h>
 #include <stb_image_write.h>
@@ -15,58 +21,112 @@ struct WindowParams {
     int max_size;
 };
 
+// Value at 0-based position `rank` of a histogram with one bin per pixel value
+static int histogram_rank(const uint64_t *hist, uint64_t rank) {
+    int v = 0;
+    while (rank >= hist[v]) {
+        rank -= hist[v];
+        ++v;
+    }
+    return v;
+}
+
 // Function to estimate optimal window sizes based on image characteristics
-WindowParams estimate_optimal_window_sizes(const std::vector<unsigned char>& gray, int width, int height) {
-    // 1. Calculate image-wide median and MAD for adaptive thresholding
-    std::vector<unsigned char> values(gray);
-    const size_t mid_idx = values.size() / 2;
-    std::nth_element(values.begin(), values.begin() + mid_idx, values.end());
-    const unsigned char median_value = values[mid_idx];
+template <typename Pixel>
+WindowParams estimate_optimal_window_sizes(const Pixel* gray, int width, int height) {
+    using accum_type = typename PixelTraits<Pixel>::accum_type;
+    constexpr int levels = static_cast<int>(PixelTraits<Pixel>::max_value) + 1;
+    const size_t pixel_count = static_cast<size_t>(width) * height;
+
+    // 1. Calculate image-wide median and MAD for adaptive thresholding from a
+    //    histogram with one bin per value (order statistics need no sorting).
+    //    Each thread counts into a heap histogram of its own that is merged after the
+    //    loop; an array reduction would place 65536 bins per thread (512 KB) on the stack
+    std::vector<uint64_t> hist_bins(levels, 0);
+    #pragma omp parallel
+    {
+        std::vector<uint64_t> local_hist(levels, 0);
+
+        #pragma omp for schedule(static) nowait
+        for (size_t i = 0; i < pixel_count; ++i) {
+            ++local_hist[gray[i]];
+        }
+
+        #pragma omp critical
+        for (int v = 0; v < levels; ++v) {
+            hist_bins[v] += local_hist[v];
+        }
+    }
+    const uint64_t *hist = hist_bins.data();
+    const int median_value = histogram_rank(hist, pixel_count / 2);
 
-    // Calculate absolute deviations from median
-    std::vector<float> abs_deviations;
-    abs_deviations.reserve(values.size());
-    for (auto val : values) {
-        abs_deviations.push_back(std::abs(static_cast<float>(val) - median_value));
+    // Absolute deviations from the median take at most `levels` distinct values
+    std::vector<uint64_t> deviation_hist(levels, 0);
+    for (int v = 0; v < levels; ++v) {
+        deviation_hist[std::abs(v - median_value)] += hist[v];
     }
 
     // Calculate MAD
-    std::nth_element(abs_deviations.begin(),
-                    abs_deviations.begin() + abs_deviations.size()/2,
-                    abs_deviations.end());
-    const float mad = abs_deviations[abs_deviations.size()/2];
+    const float mad = static_cast<float>(histogram_rank(deviation_hist.data(), pixel_count / 2));
 
-    // 2. Estimate noise using MAD-based homogeneous region detection
-    std::vector<float> block_variances;
+    // 2./3. Noise estimate from homogeneous 8x8 blocks and edge density from the
+    //       Sobel gradient, fused into one sweep over bands of block rows
     const int block_size = 8;
     const float var_threshold = 1.4826f * mad * 2.0f; // Scale factor converts MAD to standard deviation equivalent
+    const float edge_threshold = 1.4826f * mad * 1.5f; // Adaptive threshold based on MAD
+    const float edge_threshold_sq = edge_threshold * edge_threshold;
 
-    for (int y = 0; y < height - block_size; y += block_size) {
-        for (int x = 0; x < width - block_size; x += block_size) {
-            float mean = 0.0f, var = 0.0f;
+    std::vector<float> block_variances;
+    int64_t edge_count = 0;
+    const int bands = (height + block_size - 1) / block_size;
+
+    #pragma omp parallel reduction(+:edge_count)
+    {
+        std::vector<float> local_variances;
+
+        #pragma omp for schedule(static)
+        for (int band = 0; band < bands; ++band) {
+            const int y0 = band * block_size;
+
+            // Block variances (blocks start below height - block_size like before)
+            if (y0 < height - block_size) {
+                for (int x = 0; x < width - block_size; x += block_size) {
+                    accum_type sum = 0, sum_sq = 0;
+                    for (int by = 0; by < block_size; by++) {
+                        const Pixel *row = &gray[(y0 + by) * width + x];
+                        for (int bx = 0; bx < block_size; bx++) {
+                            sum += row[bx];
+                            sum_sq += static_cast<accum_type>(row[bx]) * row[bx];
+                        }
+                    }
+                    const accum_type n = block_size * block_size;
+                    const float var = static_cast<float>(n * sum_sq - sum * sum) / static_cast<float>(n * n);
 
-            // Calculate mean
-            for (int by = 0; by < block_size; by++) {
-                for (int bx = 0; bx < block_size; bx++) {
-                    mean += gray[(y + by) * width + (x + bx)];
+                    // Use MAD-based threshold for homogeneous regions
+                    if (var < var_threshold) {
+                        local_variances.push_back(var);
+                    }
                 }
             }
-            mean /= (block_size * block_size);
 
-            // Calculate variance
-            for (int by = 0; by < block_size; by++) {
-                for (int bx = 0; bx < block_size; bx++) {
-                    float diff = gray[(y + by) * width + (x + bx)] - mean;
-                    var += diff * diff;
+            // Sobel gradient magnitude, compared squared to avoid the sqrt
+            for (int y = std::max(1, y0); y < std::min(height - 1, y0 + block_size); y++) {
+                const Pixel *up = &gray[(y - 1) * width];
+                const Pixel *mid = &gray[y * width];
+                const Pixel *down = &gray[(y + 1) * width];
+                int64_t row_edges = 0;
+                #pragma omp simd reduction(+:row_edges)
+                for (int x = 1; x < width - 1; x++) {
+                    const accum_type gx = -up[x-1] - 2*mid[x-1] - down[x-1] + up[x+1] + 2*mid[x+1] + down[x+1];
+                    const accum_type gy = -up[x-1] - 2*up[x] - up[x+1] + down[x-1] + 2*down[x] + down[x+1];
+                    row_edges += (static_cast<float>(gx*gx + gy*gy) > edge_threshold_sq) ? 1 : 0;
                 }
-            }
-            var /= (block_size * block_size);
-
-            // Use MAD-based threshold for homogeneous regions
-            if (var < var_threshold) {
-                block_variances.push_back(var);
+                edge_count += row_edges;
             }
         }
+
+        #pragma omp critical
+        block_variances.insert(block_variances.end(), local_variances.begin(), local_variances.end());
     }
 
     // Robust noise estimation using median of variances
@@ -80,33 +140,15 @@ WindowParams estimate_optimal_window_sizes(const std::vector<unsigned char>& gra
         noise_level = 1.4826f * mad; // Fallback using MAD directly
     }
 
-    // 3. Compute edge density using gradient magnitude
-    float edge_density = 0.0f;
-    const float edge_threshold = 1.4826f * mad * 1.5f; // Adaptive threshold based on MAD
-
-    #pragma omp parallel for reduction(+:edge_density)
-    for (int y = 1; y < height - 1; y++) {
-        for (int x = 1; x < width - 1; x++) {
-            // Compute Sobel gradient magnitude
-            float gx = -gray[(y-1)*width + (x-1)] - 2*gray[y*width + (x-1)] - gray[(y+1)*width + (x-1)] +
-                       gray[(y-1)*width + (x+1)] + 2*gray[y*width + (x+1)] + gray[(y+1)*width + (x+1)];
-            float gy = -gray[(y-1)*width + (x-1)] - 2*gray[(y-1)*width + x] - gray[(y-1)*width + (x+1)] +
-                       gray[(y+1)*width + (x-1)] + 2*gray[(y+1)*width + x] + gray[(y+1)*width + (x+1)];
-
-            float magnitude = std::sqrt(gx*gx + gy*gy);
-            if (magnitude > edge_threshold) {
-                edge_density += 1.0f;
-            }
-        }
-    }
-    edge_density /= (width * height);
+    const float edge_density = static_cast<float>(edge_count) / static_cast<float>(width * height);
 
     // 4. Determine window sizes based on noise level and edge density
     int min_size = 3;
     int max_size;
 
     // Adaptive determination based on noise level relative to MAD
-    float relative_noise = noise_level / (1.4826f * mad);
+    // (a MAD of 0 means more than half of the image is one value, e.g. a clean page background)
+    float relative_noise = (mad > 0.0f) ? noise_level / (1.4826f * mad) : 0.0f;
     if (relative_noise < 0.5f) {
         max_size = 7;  // Low noise
     } else if (relative_noise < 1.5f) {
@@ -132,191 +174,772 @@ WindowParams estimate_optimal_window_sizes(const std::vector<unsigned char>& gra
     return {min_size, max_size};
 }
 
-void increase_window_size(const std::vector<unsigned char> &input,
-                          std::vector<unsigned char> &temp_window,
-                          int old_window_size, int new_window_size,
-                          const int width, const int height, const int xpos, const int ypos) {
+// Histogram of a window column or of a whole window: 256 fine bins plus 16 coarse
+// bins (one per 16 grey values) so that order statistics need at most 32 steps
+struct MedianHistogram {
+    uint16_t coarse[16];
+    uint16_t fine[256];
+};
 
-    const int old_half_win = (old_window_size - 1) / 2;
-    const int new_half_win = (new_window_size - 1) / 2;
+inline void add_histogram(MedianHistogram &dst, const MedianHistogram &src) {
+    #pragma omp simd
+    for (int i = 0; i < 16; ++i) dst.coarse[i] += src.coarse[i];
+    #pragma omp simd
+    for (int i = 0; i < 256; ++i) dst.fine[i] += src.fine[i];
+}
+
+inline void sub_histogram(MedianHistogram &dst, const MedianHistogram &src) {
+    #pragma omp simd
+    for (int i = 0; i < 16; ++i) dst.coarse[i] -= src.coarse[i];
+    #pragma omp simd
+    for (int i = 0; i < 256; ++i) dst.fine[i] -= src.fine[i];
+}
+
+// Value at 0-based position `rank` of the sorted window
+inline unsigned char histogram_rank(const MedianHistogram &hist, int rank) {
+    int c = 0;
+    while (rank >= hist.coarse[c]) {
+        rank -= hist.coarse[c];
+        ++c;
+    }
+    int v = c * 16;
+    while (rank >= hist.fine[v]) {
+        rank -= hist.fine[v];
+        ++v;
+    }
+    return static_cast<unsigned char>(v);
+}
 
-    // Calculate maximum number of new pixels to add
-    int max_new_elements = 4 * new_window_size - 4;
+/**
+ * Sliding-histogram window statistics after Perreault & Hébert.
+ *
+ * For every window size the filter may visit, one histogram per image column
+ * covers the rows [y - half, y + half] of the current row y. Moving to the next
+ * row removes one pixel from and adds one pixel to every column histogram; sizes
+ * that are not queried on a row are skipped and caught up on their next query.
+ * The window histogram of a size is assembled from column histograms and slid
+ * along the row by subtracting the column that leaves and adding the one that
+ * enters. Window histograms are updated lazily: a size that is not queried for
+ * a few pixels is caught up (or rebuilt) on its next query.
+ *
+ * Windows are clipped to the image like in the scalar implementation, so median,
+ * minimum and maximum are bit-identical to sorting the clipped window.
+ *
+ * Column histograms are only kept for the columns a tile can reach. The object
+ * is meant to be reused: reset() rebinds it to another tile or image and keeps
+ * the storage, so a thread allocates it once instead of once per tile.
+ */
+class WindowHistograms {
+public:
+    // Binds to the tile columns [x_begin, x_end) of an image. Storage only grows.
+    void reset(const unsigned char *input, int width, int height, const std::vector<int> &sizes,
+               int x_begin, int x_end) {
+        const int reach = sizes.back() / 2;
+        input_ = input;
+        width_ = width;
+        height_ = height;
+        row_ = -1;
+        span_begin_ = std::max(0, x_begin - reach);
+        span_width_ = std::min(width, x_end + reach) - span_begin_;
+        sizes_.assign(sizes.begin(), sizes.end());
+        const size_t columns = sizes.size() * static_cast<size_t>(span_width_);
+        if (columns_.size() < columns) columns_.resize(columns);
+        windows_.resize(sizes.size());
+        window_x_.assign(sizes.size(), -1);
+        column_row_.assign(sizes.size(), -1);
+    }
 
-    // Ensure capacity is sufficient
-    if (temp_window.capacity() < temp_window.size() + max_new_elements) {
-        temp_window.reserve(temp_window.size() + max_new_elements);
+    // Moves to row y. Column histograms follow lazily on the first query of each size.
+    void start_row(int y) {
+        row_ = y;
+        std::fill(window_x_.begin(), window_x_.end(), -1);
     }
-    // Top and bottom rows
-    for (int dx = -new_half_win; dx <= new_half_win; ++dx) {
-        const int xx = xpos + dx;
 
-        // Top new row
-        const int yy_top = ypos - new_half_win;
-        if (yy_top >= 0 && xx >= 0 && xx < width) {
-            temp_window.push_back(input[yy_top * width + xx]);
+    // Median, minimum and maximum of the clipped window of size index i centred at (x, row)
+    void query(size_t i, int x, unsigned char &median, unsigned char &min_val, unsigned char &max_val) {
+        const int half = sizes_[i] / 2;
+        MedianHistogram &window = windows_[i];
+        // Indexed by image column
+        const MedianHistogram *cols = &columns_[i * span_width_] - span_begin_;
+        int &pos = window_x_[i];
+        if (column_row_[i] != row_) {
+            advance_columns(i);
         }
 
-        // Bottom new row
-        const int yy_bottom = ypos + new_half_win;
-        if (yy_bottom < height && xx >= 0 && xx < width) {
-            temp_window.push_back(input[yy_bottom * width + xx]);
+        if (pos < 0 || x < pos || x - pos > 2 * half) {
+            // Rebuild from the column histograms
+            window = MedianHistogram{};
+            for (int xx = std::max(0, x - half); xx <= std::min(width_ - 1, x + half); ++xx) {
+                add_histogram(window, cols[xx]);
+            }
+        } else {
+            // Slide from pos to x one column at a time
+            for (int p = pos + 1; p <= x; ++p) {
+                if (p - half - 1 >= 0) sub_histogram(window, cols[p - half - 1]);
+                if (p + half < width_) add_histogram(window, cols[p + half]);
+            }
         }
+        pos = x;
+
+        const int rows = std::min(height_ - 1, row_ + half) - std::max(0, row_ - half) + 1;
+        const int cols_in = std::min(width_ - 1, x + half) - std::max(0, x - half) + 1;
+        const int count = rows * cols_in;
+        median = histogram_rank(window, count / 2);
+        min_val = histogram_rank(window, 0);
+        max_val = histogram_rank(window, count - 1);
     }
 
-    // Left and right columns (excluding corners)
-    for (int dy = -new_half_win + 1; dy < new_half_win; ++dy) {
-        const int yy = ypos + dy;
-        if (dy >= -old_half_win && dy <= old_half_win) {
-            // Left new column
-            const int xx_left = xpos - new_half_win;
-            if (xx_left >= 0 && yy >= 0 && yy < height) {
-                temp_window.push_back(input[yy * width + xx_left]);
+private:
+    // Brings the column histograms of size index i to the current row, one row
+    // at a time if they are close behind, otherwise by rebuilding them
+    void advance_columns(size_t i) {
+        const int half = sizes_[i] / 2;
+        MedianHistogram *cols = &columns_[i * span_width_];
+        int &from = column_row_[i];
+
+        if (from >= 0 && from < row_ && row_ - from <= 2 * half) {
+            for (int y = from + 1; y <= row_; ++y) {
+                const int leaving = y - 1 - half;
+                const int entering = y + half;
+                if (leaving >= 0) {
+                    const unsigned char *row = input_ + static_cast<size_t>(leaving) * width_ + span_begin_;
+                    for (int x = 0; x < span_width_; ++x) remove_value(cols[x], row[x]);
+                }
+                if (entering < height_) {
+                    const unsigned char *row = input_ + static_cast<size_t>(entering) * width_ + span_begin_;
+                    for (int x = 0; x < span_width_; ++x) add_value(cols[x], row[x]);
+                }
             }
-
-            // Right new column
-            const int xx_right = xpos + new_half_win;
-            if (xx_right < width && yy >= 0 && yy < height) {
-                temp_window.push_back(input[yy * width + xx_right]);
+        } else {
+            std::fill(cols, cols + span_width_, MedianHistogram{});
+            for (int yy = std::max(0, row_ - half); yy <= std::min(height_ - 1, row_ + half); ++yy) {
+                const unsigned char *row = input_ + static_cast<size_t>(yy) * width_ + span_begin_;
+                for (int x = 0; x < span_width_; ++x) add_value(cols[x], row[x]);
             }
         }
+        from = row_;
+    }
+
+    static void add_value(MedianHistogram &hist, unsigned char v) {
+        ++hist.coarse[v >> 4];
+        ++hist.fine[v];
+    }
+
+    static void remove_value(MedianHistogram &hist, unsigned char v) {
+        --hist.coarse[v >> 4];
+        --hist.fine[v];
+    }
+
+    const unsigned char *input_ = nullptr;
+    int width_ = 0;
+    int height_ = 0;
+    int row_ = -1;
+    int span_begin_ = 0;  // first image column with a column histogram
+    int span_width_ = 0;
+    std::vector<int> sizes_;
+    std::vector<MedianHistogram> columns_;
+    std::vector<MedianHistogram> windows_;
+    std::vector<int> window_x_;
+    std::vector<int> column_row_;
+};
+
+/**
+ * Window statistics of 16-bit planes, with the interface of WindowHistograms.
+ * A histogram per column would need 65536 bins, so every query gathers the
+ * clipped window and selects the median with nth_element. Only pixels that
+ * fall through the sorting networks (image borders, windows above 7x7) get
+ * here, and the gather buffer is reused across queries.
+ */
+class WindowSelection {
+public:
+    void reset(const uint16_t *input, int width, int height, const std::vector<int> &sizes, int, int) {
+        input_ = input;
+        width_ = width;
+        height_ = height;
+        sizes_.assign(sizes.begin(), sizes.end());
+    }
+
+    void start_row(int y) { row_ = y; }
+
+    void query(size_t i, int x, uint16_t &median, uint16_t &min_val, uint16_t &max_val) {
+        const int half = sizes_[i] / 2;
+        window_.clear();
+        for (int yy = std::max(0, row_ - half); yy <= std::min(height_ - 1, row_ + half); ++yy) {
+            const uint16_t *row = input_ + static_cast<size_t>(yy) * width_;
+            window_.insert(window_.end(), row + std::max(0, x - half), row + std::min(width_ - 1, x + half) + 1);
+        }
+        auto mid = window_.begin() + window_.size() / 2;
+        std::nth_element(window_.begin(), mid, window_.end());
+        median = *mid;
+        // nth_element partitions around the median, so each extreme lies on its side
+        min_val = *std::min_element(window_.begin(), mid + 1);
+        max_val = *std::max_element(mid, window_.end());
+    }
+
+private:
+    const uint16_t *input_ = nullptr;
+    int width_ = 0;
+    int height_ = 0;
+    int row_ = -1;
+    std::vector<int> sizes_;
+    std::vector<uint16_t> window_;
+};
+
+// Window statistics used for the pixels outside the sorting-network fast path
+template <typename Pixel>
+struct WindowStatsFor {
+    using type = WindowHistograms;
+};
+
+template <>
+struct WindowStatsFor<uint16_t> {
+    using type = WindowSelection;
+};
+
+// Number of neighbouring pixels handled together by the sorting-network fast path
+constexpr int NETWORK_LANES = 32;
+
+/**
+ * Min/max selection network for the median, minimum and maximum of a fixed
+ * size x size window.
+ *
+ * Built from Batcher's odd-even merge sort over the next power of two. The
+ * padding wires hold the largest pixel value, so comparators against them are no-ops or plain
+ * moves and are resolved at build time. Comparators that cannot influence the
+ * three requested ranks are pruned. Every remaining comparator is a branch-free
+ * min/max pair.
+ */
+struct SelectionNetwork {
+    std::vector<std::pair<int, int>> ops; // (lower, upper) slots of each comparator
+    int median_slot = 0;
+    int min_slot = 0;
+    int max_slot = 0;
+};
+
+static void odd_even_merge(int lo, int n, int r, std::vector<std::pair<int, int>> &cmp) {
+    const int step = r * 2;
+    if (step < n) {
+        odd_even_merge(lo, n, step, cmp);
+        odd_even_merge(lo + r, n, step, cmp);
+        for (int i = lo + r; i + r < lo + n; i += step) {
+            cmp.emplace_back(i, i + r);
+        }
+    } else {
+        cmp.emplace_back(lo, lo + r);
     }
 }
 
-// Function to extract a window from the image at a given location
-void get_window(const std::vector<unsigned char> &input,
-                int width, int height,
-                int x, int y,
-                int window_size,
-                std::vector<unsigned char> &output_window) {
-
-    output_window.clear();
-    const int half_win = window_size / 2;
-
-    // Estimate required capacity and reserve once
-    int estimated_size = (window_size * window_size * 3) / 4; // ~75% of window might be valid
-    output_window.reserve(estimated_size);
-
-    for (int dy = -half_win; dy <= half_win; ++dy) {
-        const int yy = y + dy;
-        if (yy < 0 || yy >= height) continue;
-
-        const int row_offset = yy * width;
-        for (int dx = -half_win; dx <= half_win; ++dx) {
-            const int xx = x + dx;
-            if (xx >= 0 && xx < width) {
-                output_window.push_back(input[row_offset + xx]);
-            }
+static void odd_even_merge_sort(int lo, int n, std::vector<std::pair<int, int>> &cmp) {
+    if (n > 1) {
+        const int m = n / 2;
+        odd_even_merge_sort(lo, m, cmp);
+        odd_even_merge_sort(lo + m, m, cmp);
+        odd_even_merge(lo, n, 1, cmp);
+    }
+}
+
+static SelectionNetwork build_selection_network(int size) {
+    const int n = size * size;
+    int padded = 1;
+    while (padded < n) padded *= 2;
+
+    std::vector<std::pair<int, int>> comparators;
+    odd_even_merge_sort(0, padded, comparators);
+
+    // slot[w]: which value slot wire w currently holds, -1 for the constant 255
+    std::vector<int> slot(padded, -1);
+    for (int w = 0; w < n; ++w) slot[w] = w;
+
+    SelectionNetwork net;
+    for (const auto &c : comparators) {
+        const int lo = slot[c.first], hi = slot[c.second];
+        if (hi < 0) continue;             // min(v, 255) leaves both wires unchanged
+        if (lo < 0) {                     // the 255 moves up, the value moves down
+            slot[c.first] = hi;
+            slot[c.second] = -1;
+            continue;
+        }
+        net.ops.emplace_back(lo, hi);
+    }
+    net.min_slot = slot[0];
+    net.median_slot = slot[n / 2];
+    net.max_slot = slot[n - 1];
+
+    // Backward pass: drop comparators whose results are never read
+    std::vector<bool> needed(n, false);
+    needed[net.min_slot] = needed[net.median_slot] = needed[net.max_slot] = true;
+    std::vector<std::pair<int, int>> pruned;
+    for (auto it = net.ops.rbegin(); it != net.ops.rend(); ++it) {
+        if (needed[it->first] || needed[it->second]) {
+            needed[it->first] = needed[it->second] = true;
+            pruned.push_back(*it);
         }
     }
+    net.ops.assign(pruned.rbegin(), pruned.rend());
+    return net;
 }
 
-// Adaptive median filtering process
-void adaptive_median_filter_process(const std::vector<unsigned char> &input, std::vector<unsigned char> *output,
-                                   const int width, const int height, const int channels,
-                                   int min_win_size, int max_window_size) {
+// Networks for the window sizes that have a fast path (3x3, 5x5, 7x7)
+static const SelectionNetwork* selection_network(int size) {
+    static const SelectionNetwork networks[3] = {
+        build_selection_network(3), build_selection_network(5), build_selection_network(7)};
+    if (size == 3 || size == 5 || size == 7) {
+        return &networks[(size - 3) / 2];
+    }
+    return nullptr;
+}
 
-    #pragma omp parallel for schedule(dynamic)
-    for (int y = 0; y < height; ++y) {
-        std::vector<unsigned char> temp_window;
-        temp_window.reserve(max_window_size * max_window_size);
+/**
+ * Median, minimum and maximum of the size x size windows centred at
+ * (x0 .. x0 + NETWORK_LANES - 1, y). All windows must lie inside the image.
+ * Every comparator is applied to all lanes at once, so the lane loop
+ * vectorises into byte-wise (16-bit images: word-wise) vector min/max operations.
+ */
+template <typename Pixel>
+static void network_window_stats(const SelectionNetwork &net, const Pixel *input, int width,
+                                 int x0, int y, int size,
+                                 Pixel *median, Pixel *min_val, Pixel *max_val) {
+    const int half = size / 2;
+    alignas(64) Pixel v[49][NETWORK_LANES];
+
+    int k = 0;
+    for (int dy = -half; dy <= half; ++dy) {
+        const Pixel *row = input + static_cast<size_t>(y + dy) * width + x0 - half;
+        for (int dx = 0; dx < size; ++dx, ++k) {
+            std::copy(row + dx, row + dx + NETWORK_LANES, v[k]);
+        }
+    }
+
+    for (const auto &op : net.ops) {
+        Pixel *lo = v[op.first];
+        Pixel *hi = v[op.second];
+        #pragma omp simd
+        for (int l = 0; l < NETWORK_LANES; ++l) {
+            const Pixel a = lo[l], b = hi[l];
+            lo[l] = std::min(a, b);
+            hi[l] = std::max(a, b);
+        }
+    }
 
-        for (int x = 0; x < width; ++x) {
-            const int pos = y * width + x;
-            const unsigned char pxl = input[pos];
+    std::copy(v[net.median_slot], v[net.median_slot] + NETWORK_LANES, median);
+    std::copy(v[net.min_slot], v[net.min_slot] + NETWORK_LANES, min_val);
+    std::copy(v[net.max_slot], v[net.max_slot] + NETWORK_LANES, max_val);
+}
 
-            int current_win_size = min_win_size;
-            temp_window.clear();
+/**
+ * Growing-window procedure for a single pixel, starting at window size index
+ * `level`, with the statistics taken from the sliding histograms (or the
+ * window selection of 16-bit planes).
+ */
+template <typename Pixel, typename WindowStats>
+static Pixel resolve_pixel(WindowStats &hist, const std::vector<int> &sizes, size_t level,
+                           int x, Pixel pxl, int max_window_size) {
+    Pixel local_median, local_min, local_max;
+
+    while (sizes[level] < max_window_size) {
+        hist.query(level, x, local_median, local_min, local_max);
+
+        if (local_median > local_min && local_median < local_max) {
+            return (pxl > local_min && pxl < local_max) ? pxl : local_median;
+        }
+        ++level;
+    }
 
-            // Extract initial window
-            get_window(input, width, height, x, y, current_win_size, temp_window);
+    hist.query(level, x, local_median, local_min, local_max);
+    return local_median;
+}
 
-            bool flag = false;
+// One image plane to be filtered, with the window sizes estimated for it
+template <typename Pixel>
+struct MedianPlane {
+    const Pixel *input;
+    Pixel *output;
+    const unsigned char *impulse_map; // non-zero where filtering is needed, nullptr for all pixels
+    std::vector<int> sizes;   // window sizes visited by the growing-window loop
+    int max_window_size;
+    size_t network_levels;    // leading sizes that have a sorting-network fast path
+    int network_half;         // half of the largest network size
+};
 
-            while (!flag && current_win_size < max_window_size) {
-                // Partielle Sortierung mit nth_element - effizienter als vollständige Sortierung
-                const size_t mid_idx = temp_window.size() / 2;
-                std::nth_element(temp_window.begin(), temp_window.begin() + mid_idx, temp_window.end());
+template <typename Pixel>
+static MedianPlane<Pixel> make_median_plane(const Pixel *input, Pixel *output,
+                                            int min_win_size, int max_window_size,
+                                            const unsigned char *impulse_map = nullptr) {
+    MedianPlane<Pixel> plane{input, output, impulse_map, {min_win_size}, max_window_size, 0, 0};
 
-                const unsigned char local_median = temp_window[mid_idx];
-                const unsigned char local_min = *std::min_element(temp_window.begin(), temp_window.end());
-                const unsigned char local_max = *std::max_element(temp_window.begin(), temp_window.end());
+    // Window sizes visited by the growing-window loop: min, min + 2, ... up to the
+    // first size that is not smaller than max (only its median is used)
+    while (plane.sizes.back() < max_window_size) {
+        plane.sizes.push_back(plane.sizes.back() + 2);
+    }
 
-                if (local_median > local_min && local_median < local_max) {
-                    if (pxl > local_min && pxl < local_max) {
-                        (*output)[pos] = pxl;
-                    } else {
-                        (*output)[pos] = local_median;
-                    }
-                    flag = true;
-                } else {
-                    const int old_win_size = current_win_size;
-                    current_win_size += 2;
+    while (plane.network_levels < plane.sizes.size() && selection_network(plane.sizes[plane.network_levels])) {
+        ++plane.network_levels;
+    }
+    plane.network_half = plane.network_levels > 0 ? plane.sizes[plane.network_levels - 1] / 2 : 0;
+    return plane;
+}
 
-                    // Nur neue Elemente des größeren Fensters hinzufügen
-                    increase_window_size(input, temp_window, old_win_size, current_win_size, width, height, x, y);
+// Most neighbours an impulse candidate may share its value with (small clusters of impulses)
+constexpr int MAX_IMPULSE_CLUSTER_NEIGHBOURS = 2;
+
+/**
+ * Flags candidate impulse pixels: pixels that are the minimum or maximum of
+ * their clipped 3x3 neighbourhood and share their value with at most
+ * MAX_IMPULSE_CLUSTER_NEIGHBOURS neighbours. Isolated salt and pepper pixels
+ * (and pairs or triples of them) are flagged; flat areas, smooth gradients
+ * and the edges of strokes, whose value continues in several neighbours, are
+ * not. The interior of each row is a branch-free sweep that vectorises.
+ *
+ * @param input Input plane.
+ * @param map Output map, 1 for candidate pixels and 0 otherwise.
+ * @return Number of flagged pixels.
+ */
+template <typename Pixel>
+static int64_t detect_impulses(const Pixel *input, unsigned char *map, int width, int height) {
+    int64_t flagged = 0;
+
+    #pragma omp parallel for schedule(static) reduction(+:flagged)
+    for (int y = 0; y < height; ++y) {
+        const Pixel *mid = input + static_cast<size_t>(y) * width;
+        unsigned char *map_row = map + static_cast<size_t>(y) * width;
+
+        // Clipped neighbourhood, used for border pixels
+        auto flag_pixel = [&](int x) {
+            const Pixel v = mid[x];
+            Pixel lo = static_cast<Pixel>(PixelTraits<Pixel>::max_value), hi = 0;
+            int neighbours = 0, equal = 0;
+            for (int dy = -1; dy <= 1; ++dy) {
+                const int yy = y + dy;
+                if (yy < 0 || yy >= height) continue;
+                for (int dx = -1; dx <= 1; ++dx) {
+                    const int xx = x + dx;
+                    if ((dx == 0 && dy == 0) || xx < 0 || xx >= width) continue;
+                    const Pixel n = input[static_cast<size_t>(yy) * width + xx];
+                    lo = std::min(lo, n);
+                    hi = std::max(hi, n);
+                    equal += (n == v);
+                    ++neighbours;
                 }
             }
-
-            if (!flag) {
-                const size_t mid_idx = temp_window.size() / 2;
-                std::nth_element(temp_window.begin(), temp_window.begin() + mid_idx, temp_window.end());
-                (*output)[pos] = temp_window[mid_idx];
+            return static_cast<unsigned char>(neighbours > 0 && (v <= lo || v >= hi) &&
+                                              equal <= MAX_IMPULSE_CLUSTER_NEIGHBOURS);
+        };
+
+        if (y == 0 || y == height - 1 || width < 3) {
+            for (int x = 0; x < width; ++x) map_row[x] = flag_pixel(x);
+        } else {
+            const Pixel *up = mid - width;
+            const Pixel *down = mid + width;
+            map_row[0] = flag_pixel(0);
+            #pragma omp simd
+            for (int x = 1; x < width - 1; ++x) {
+                const Pixel v = mid[x];
+                const Pixel n[8] = {up[x-1], up[x], up[x+1], mid[x-1], mid[x+1], down[x-1], down[x], down[x+1]};
+                Pixel lo = n[0], hi = n[0];
+                int equal = 0;
+                for (int i = 0; i < 8; ++i) {
+                    lo = std::min(lo, n[i]);
+                    hi = std::max(hi, n[i]);
+                    equal += (n[i] == v);
+                }
+                map_row[x] = ((v <= lo) | (v >= hi)) & (equal <= MAX_IMPULSE_CLUSTER_NEIGHBOURS);
             }
+            map_row[width - 1] = flag_pixel(width - 1);
         }
+
+        for (int x = 0; x < width; ++x) flagged += map_row[x];
     }
+    return flagged;
 }
 
-void adaptive_median_filter(const std::string &input_path, std::string output_path) {
+/**
+ * Filters the tile [x_begin, x_end) x [y_begin, y_end) of one plane: sorting
+ * networks for interior batches, sliding histograms for everything that falls
+ * through. With an impulse map, unflagged pixels are copied through and
+ * batches without any flagged pixel are skipped entirely.
+ *
+ * @param hist Scratch histograms (or window selection) of the calling thread, rebound to this tile.
+ */
+template <typename Pixel, typename WindowStats>
+static void filter_tile(const MedianPlane<Pixel> &plane, WindowStats &hist, int width, int height,
+                        int x_begin, int x_end, int y_begin, int y_end) {
+    const std::vector<int> &sizes = plane.sizes;
+    const int max_window_size = plane.max_window_size;
+    const size_t network_levels = plane.network_levels;
+    const int network_half = plane.network_half;
+
+    hist.reset(plane.input, width, height, sizes, x_begin, x_end);
+    alignas(64) Pixel median[NETWORK_LANES], min_val[NETWORK_LANES], max_val[NETWORK_LANES];
+
+    for (int y = y_begin; y < y_end; ++y) {
+        hist.start_row(y);
+        const Pixel *in_row = plane.input + static_cast<size_t>(y) * width;
+        Pixel *out_row = plane.output + static_cast<size_t>(y) * width;
+        const unsigned char *map_row = plane.impulse_map ? plane.impulse_map + static_cast<size_t>(y) * width : nullptr;
+        auto scalar_pixel = [&](int x) {
+            out_row[x] = (map_row && !map_row[x]) ? in_row[x]
+                                                  : resolve_pixel(hist, sizes, 0, x, in_row[x], max_window_size);
+        };
+
+        // Fast path: batches whose largest network window lies inside the image
+        int x = x_begin;
+        const bool rows_inside = network_levels > 0 && y >= network_half && y + network_half < height;
+        if (rows_inside) {
+            for (; x < network_half; ++x) {
+                scalar_pixel(x);
+            }
+            for (; x + NETWORK_LANES <= x_end && x + NETWORK_LANES + network_half <= width; x += NETWORK_LANES) {
+                uint32_t pending = 0xFFFFFFFFu;
+                if (map_row) {
+                    pending = 0;
+                    for (int l = 0; l < NETWORK_LANES; ++l) {
+                        pending |= static_cast<uint32_t>(map_row[x + l] != 0) << l;
+                    }
+                    std::copy(in_row + x, in_row + x + NETWORK_LANES, out_row + x);
+                    if (!pending) continue;
+                }
+                size_t level = 0;
+                for (; level < network_levels && pending; ++level) {
+                    const int size = sizes[level];
+                    network_window_stats(*selection_network(size), plane.input, width, x, y, size,
+                                         median, min_val, max_val);
+                    const bool last = size >= max_window_size;
+                    for (int l = 0; l < NETWORK_LANES; ++l) {
+                        if (!(pending & (1u << l))) continue;
+                        const Pixel pxl = in_row[x + l];
+                        if (last) {
+                            out_row[x + l] = median[l];
+                        } else if (median[l] > min_val[l] && median[l] < max_val[l]) {
+                            out_row[x + l] = (pxl > min_val[l] && pxl < max_val[l]) ? pxl : median[l];
+                        } else {
+                            continue;
+                        }
+                        pending &= ~(1u << l);
+                    }
+                }
+                // Pixels that failed every network size continue on the histograms
+                for (int l = 0; l < NETWORK_LANES && pending; ++l) {
+                    if (pending & (1u << l)) {
+                        out_row[x + l] = resolve_pixel(hist, sizes, level, x + l, in_row[x + l], max_window_size);
+                        pending &= ~(1u << l);
+                    }
+                }
+            }
+        }
 
-    spdlog::info("adaptive_median_filter Starting processing on: {}", input_path);
+        // Border columns, border rows and the tail of the tile row
+        for (; x < x_end; ++x) {
+            scalar_pixel(x);
+        }
+    }
+}
 
-    int width, height, channels;
+// Tile size of the median filter work distribution. The width is a multiple of
+// NETWORK_LANES so that network batches never straddle two tiles.
+constexpr int TILE_WIDTH = 8 * NETWORK_LANES;
+constexpr int TILE_HEIGHT = 64;
+
+// Scratch histograms (or window selection) of the calling thread, allocated on
+// first use and kept for all later tiles and images
+template <typename WindowStats>
+static WindowStats &thread_histograms() {
+    static thread_local WindowStats hist;
+    return hist;
+}
 
-    // Load the input image from the file path
-    unsigned char *image = stbi_load(input_path.c_str(), &width, &height, &channels, 0);
+/**
+ * Filters several planes of the same size at once. Work items are
+ * (plane, tile row, tile column) triples handed out dynamically, so all planes
+ * share one parallel loop and expensive regions (edges that grow the window)
+ * are spread over the threads. Within a tile the column histograms advance
+ * incrementally from one row to the next and only cover the tile's columns.
+ */
+template <typename Pixel>
+static void adaptive_median_filter_planes(const std::vector<MedianPlane<Pixel>> &planes, int width, int height) {
+    const int tile_rows = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+    const int tile_cols = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+    const int tiles = tile_rows * tile_cols;
+    const int items = static_cast<int>(planes.size()) * tiles;
 
-    if (!image) {
-        spdlog::error("[adaptive_median_filter] Failed to load image: {}", input_path);
-        return;
+    #pragma omp parallel for schedule(dynamic)
+    for (int item = 0; item < items; ++item) {
+        TraceSpan span("median_tile");
+        const int tile = item % tiles;
+        const int ty = tile / tile_cols;
+        const int tx = tile % tile_cols;
+        filter_tile(planes[item / tiles], thread_histograms<typename WindowStatsFor<Pixel>::type>(), width, height,
+                    tx * TILE_WIDTH, std::min(width, (tx + 1) * TILE_WIDTH),
+                    ty * TILE_HEIGHT, std::min(height, (ty + 1) * TILE_HEIGHT));
     }
+}
+
+// Adaptive median filtering process
+void adaptive_median_filter_process(const unsigned char *input, unsigned char *output,
+                                   const int width, const int height, const int channels,
+                                   int min_win_size, int max_window_size) {
+    adaptive_median_filter_planes<unsigned char>({make_median_plane(input, output, min_win_size, max_window_size)},
+                                  width, height);
+}
 
+/**
+ * Filters an already decoded image and writes the result with the same bit
+ * depth.
+ *
+ * @param input_path Path of the decoded image (names the output if output_path is empty).
+ * @param image Interleaved image (width x height x channels).
+ * @param gray Grayscale plane of image to filter instead of converting again; nullptr to convert here.
+ *             Ignored in colour mode.
+ */
+template <typename Pixel>
+void adaptive_median_filter_decoded(const std::string &input_path, std::string output_path, const Pixel *image,
+                                    int width, int height, int channels, bool color, bool impulse_map,
+                                    const Pixel *gray) {
     // If no output path is specified, generate one based on the input path
     if (output_path.empty()) {
         output_path = make_output_path(input_path, "amf");
     }
 
-    // Convert the image to grayscale using standard luminance weights
-    std::vector<unsigned char> gray(width * height);
+    if (color && channels < 3) {
+        spdlog::warn("[adaptive_median_filter] Image has {} channel(s), filtering as grayscale", channels);
+        color = false;
+    }
+
+    const int pixels = width * height;
+    const int filtered_channels = color ? 3 : 1;
+    const int output_channels = color ? channels : 1;
+
+    // Planar (SoA) input: either the gray image or one plane per colour channel;
+    // a gray plane passed in by the caller is filtered directly
+    std::vector<Plane<Pixel>> planes;
+    std::vector<const Pixel *> sources;
+    if (color || !gray) {
+        for (int c = 0; c < filtered_channels; ++c) {
+            planes.emplace_back(pixels);
+            sources.push_back(planes[c].data());
+        }
 
-    // Parallel loop to speed up grayscale conversion
-#pragma omp parallel for simd
-    for (int i = 0; i < width * height; ++i) {
-        gray[i] = static_cast<unsigned char>(
-            0.2126f * image[i * channels + 0] +
-            0.7152f * image[i * channels + 1] +
-            0.0722f * image[i * channels + 2]);
+        PerfStage gray_stage("gray", pixels, color ? "rgb planes" : "");
+        if (color) {
+            // Deinterleave RGB once so every plane is filtered with contiguous rows
+#pragma omp parallel for
+            for (int i = 0; i < pixels; ++i) {
+                planes[0][i] = image[i * channels + 0];
+                planes[1][i] = image[i * channels + 1];
+                planes[2][i] = image[i * channels + 2];
+            }
+        } else {
+            // Convert the image to grayscale using standard luminance weights
+            convert_to_grayscale(image, channels, planes[0].data(), planes[0].size());
+        }
+    } else {
+        sources.push_back(gray);
     }
 
-    // Estimate optimal window sizes
-    WindowParams params = estimate_optimal_window_sizes(gray, width, height);
+    // Estimate optimal window sizes (per plane, noise can differ between channels)
+    std::vector<WindowParams> params;
+    {
+        PerfStage stage("statistics", pixels, "window size estimation");
+        for (int c = 0; c < filtered_channels; ++c) {
+            params.push_back(estimate_optimal_window_sizes(sources[c], width, height));
+        }
+    }
 
-    std::vector<unsigned char> output(width * height);
+    // Impulse detection, filtering and re-interleaving; the write is a separate stage
+    PerfStage filter_stage("filter", pixels, impulse_map ? "impulse map" : "");
+
+    // Optional pre-pass: only candidate impulse pixels go through the filter
+    std::vector<Plane<unsigned char>> impulse_maps;
+    if (impulse_map) {
+        for (int c = 0; c < filtered_channels; ++c) impulse_maps.emplace_back(pixels);
+        for (int c = 0; c < filtered_channels; ++c) {
+            const int64_t flagged = detect_impulses(sources[c], impulse_maps[c].data(), width, height);
+            spdlog::info("[adaptive_median_filter] Plane {}: {} candidate impulse pixels ({:.2f}%)",
+                         c, flagged, 100.0 * static_cast<double>(flagged) / std::max(pixels, 1));
+        }
+    }
+
+    std::vector<Plane<Pixel>> filtered;
+    for (int c = 0; c < filtered_channels; ++c) filtered.emplace_back(pixels);
+    std::vector<MedianPlane<Pixel>> median_planes;
+    for (int c = 0; c < filtered_channels; ++c) {
+        median_planes.push_back(make_median_plane(sources[c], filtered[c].data(),
+                                                  params[c].min_size, params[c].max_size,
+                                                  impulse_map ? impulse_maps[c].data() : nullptr));
+    }
 
-    auto start = std::chrono::high_resolution_clock::now();
+    // Apply the adaptive median filter to all planes in one parallel loop
+    adaptive_median_filter_planes(median_planes, width, height);
+
+    // Re-interleave only for the output; an alpha channel is passed through
+    Plane<Pixel> output;
+    if (color) {
+        output = Plane<Pixel>(static_cast<size_t>(pixels) * output_channels);
+#pragma omp parallel for
+        for (int i = 0; i < pixels; ++i) {
+            output[i * output_channels + 0] = filtered[0][i];
+            output[i * output_channels + 1] = filtered[1][i];
+            output[i * output_channels + 2] = filtered[2][i];
+            for (int c = 3; c < output_channels; ++c) {
+                output[i * output_channels + c] = image[i * channels + c];
+            }
+        }
+    } else {
+        output = std::move(filtered[0]);
+    }
 
-    // Apply the adaptive median filter to the grayscale image
-    adaptive_median_filter_process(gray, &output, width, height, 1, params.min_size, params.max_size);
+    spdlog::info("adaptive_median_filter Total runtime: {} seconds", filter_stage.stop());
 
-    if (!write_binary_image(output_path, width, height, 1, output.data())) {
+    bool written;
+    if constexpr (sizeof(Pixel) == 2) {
+        written = write_image_16(output_path, width, height, output_channels, output.data());
+    } else {
+        written = write_binary_image(output_path, width, height, output_channels, output.data());
+    }
+    if (!written) {
         spdlog::error("[adaptive_median_filter] Failed to write filtered image: {}", output_path);
     } else {
         spdlog::info("[adaptive_median_filter] Filtered image saved to: {}", output_path);
     }
+}
+
+template void adaptive_median_filter_decoded<uint8_t>(const std::string &, std::string, const uint8_t *,
+                                                      int, int, int, bool, bool, const uint8_t *);
+template void adaptive_median_filter_decoded<uint16_t>(const std::string &, std::string, const uint16_t *,
+                                                       int, int, int, bool, bool, const uint16_t *);
+
+/**
+ * Loads an image with Pixel samples, filters it and writes the result with the
+ * same bit depth.
+ */
+template <typename Pixel>
+static void run_adaptive_median_filter(const std::string &input_path, std::string output_path,
+                                       bool color, bool impulse_map) {
+    int width, height, channels;
+
+    // Load the input image from the file path
+    Pixel *image = load_image<Pixel>(input_path, width, height, channels);
+
+    if (!image) {
+        spdlog::error("[adaptive_median_filter] Failed to load image: {}", input_path);
+        return;
+    }
 
+    adaptive_median_filter_decoded(input_path, output_path, image, width, height, channels, color, impulse_map);
     stbi_image_free(image);
+}
+
+void adaptive_median_filter(const std::string &input_path, std::string output_path, bool color, bool impulse_map) {
+    PerfJob job("adaptive_median");
 
-    auto end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<float> duration = end - start;
-    spdlog::info("adaptive_median_filter Total runtime: {} seconds", duration.count());
-}
\ No newline at end of file
+    spdlog::info("adaptive_median_filter Starting processing on: {} (color: {}, impulse map: {})",
+                 input_path, color, impulse_map);
+
+    // 16-bit images are filtered and written at full precision
+    if (is_16bit_image(input_path)) {
+        spdlog::info("[adaptive_median_filter] 16-bit input");
+        run_adaptive_median_filter<uint16_t>(input_path, output_path, color, impulse_map);
+    } else {
+        run_adaptive_median_filter<unsigned char>(input_path, output_path, color, impulse_map);
+    }
+}
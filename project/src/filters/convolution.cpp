@@ -0,0 +1,450 @@
+#include <filters/convolution.h>
+#include <utils/image_io.h>
+#include <utils/plane_arena.h>
+#include <utils/perf_report.h>
+#include <utils/trace.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <numeric>
+#include <omp.h>
+#include <stb_image.h>
+#include <spdlog/spdlog.h>
+
+// Tile size of the work distribution. The horizontally filtered rows of one
+// tile (plus the vertical halo) stay in the L2 cache of the thread.
+constexpr int TILE_WIDTH = 256;
+constexpr int TILE_HEIGHT = 64;
+
+// Largest sum of kernel weights for which 255 * sum still fits into uint16
+constexpr int MAX_KERNEL_SUM = 257;
+
+// Fixed-point shift of the final normalisation (exact for all supported kernels)
+constexpr int NORM_SHIFT = 48;
+
+bool parse_border_mode(const std::string &name, BorderMode &mode) {
+    if (name == "replicate") {
+        mode = BorderMode::Replicate;
+    } else if (name == "reflect") {
+        mode = BorderMode::Reflect;
+    } else if (name == "constant") {
+        mode = BorderMode::Constant;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static const char *border_mode_name(BorderMode mode) {
+    switch (mode) {
+        case BorderMode::Replicate: return "replicate";
+        case BorderMode::Reflect: return "reflect";
+        case BorderMode::Constant: return "constant";
+    }
+    return "unknown";
+}
+
+/**
+ * Maps a possibly out-of-range coordinate into [0, n).
+ *
+ * @return Source coordinate, or -1 if the pixel is a constant (zero) border pixel.
+ */
+static int border_index(int i, int n, BorderMode mode) {
+    if (i >= 0 && i < n) return i;
+    switch (mode) {
+        case BorderMode::Replicate:
+            return std::clamp(i, 0, n - 1);
+        case BorderMode::Reflect: {
+            if (n == 1) return 0;
+            const int period = 2 * (n - 1);
+            i = std::abs(i) % period;
+            return i < n ? i : period - i;
+        }
+        case BorderMode::Constant:
+            break;
+    }
+    return -1;
+}
+
+/**
+ * Builds a Gaussian kernel with radius ceil(3 sigma). The weights are quantised
+ * to 8-bit fixed point (sum 256): every weight is rounded down and the remainder
+ * is handed out in symmetric pairs by largest fraction, so the kernel stays
+ * symmetric and sums to exactly 256.
+ *
+ * @param sigma Standard deviation in pixels.
+ */
+SeparableKernel gaussian_kernel(float sigma) {
+    sigma = std::max(sigma, 0.1f);
+    const int radius = std::max(1, static_cast<int>(std::ceil(3.0f * sigma)));
+
+    std::vector<double> weights(2 * radius + 1);
+    for (int i = -radius; i <= radius; ++i) {
+        weights[i + radius] = std::exp(-0.5 * i * i / (static_cast<double>(sigma) * sigma));
+    }
+    const double total = std::accumulate(weights.begin(), weights.end(), 0.0);
+
+    SeparableKernel kernel;
+    kernel.taps.resize(weights.size());
+    int sum = 0;
+    for (size_t i = 0; i < weights.size(); ++i) {
+        weights[i] *= 256.0 / total;
+        kernel.taps[i] = static_cast<uint16_t>(weights[i]);
+        sum += kernel.taps[i];
+    }
+
+    // Off-centre pairs ordered by their rounding loss
+    std::vector<int> pairs(radius);
+    std::iota(pairs.begin(), pairs.end(), 1);
+    std::sort(pairs.begin(), pairs.end(), [&](int a, int b) {
+        const double fa = weights[radius + a] - kernel.taps[radius + a];
+        const double fb = weights[radius + b] - kernel.taps[radius + b];
+        return fa > fb;
+    });
+    int remainder = 256 - sum;
+    for (size_t p = 0; p < pairs.size() && remainder >= 2; ++p, remainder -= 2) {
+        ++kernel.taps[radius - pairs[p]];
+        ++kernel.taps[radius + pairs[p]];
+    }
+    kernel.taps[radius] += remainder;
+    return kernel;
+}
+
+/**
+ * Builds a box kernel. Even sizes are rounded up to the next odd size and sizes
+ * above MAX_KERNEL_SUM are clamped.
+ *
+ * @param size Kernel size in pixels.
+ */
+SeparableKernel box_kernel(int size) {
+    size = std::max(1, size) | 1;
+    if (size > MAX_KERNEL_SUM) {
+        spdlog::warn("[convolution] Box size {} too large, clamping to {}", size, MAX_KERNEL_SUM);
+        size = MAX_KERNEL_SUM;
+    }
+    return {std::vector<uint16_t>(size, 1)};
+}
+
+// Per-thread scratch buffers, allocated on first use and kept for all later tiles and images
+struct ConvolutionScratch {
+    std::vector<unsigned char> padded; // one source row with the border applied
+    std::vector<uint16_t> rows;        // horizontally filtered rows of the tile and its halo
+    std::vector<int16_t> rows_dy;      // second set of rows (Sobel smoothing pass)
+    std::vector<uint32_t> acc;         // vertical accumulator of one output row
+};
+
+static ConvolutionScratch &thread_scratch() {
+    static thread_local ConvolutionScratch scratch;
+    return scratch;
+}
+
+template <typename T>
+static T *grow(std::vector<T> &buffer, size_t size) {
+    if (buffer.size() < size) buffer.resize(size);
+    return buffer.data();
+}
+
+/**
+ * Returns the columns [x_begin - radius, x_end + radius) of source row y with
+ * the border applied. Rows that do not touch the border are returned in place.
+ */
+static const unsigned char *bordered_row(const unsigned char *input, int width, int height, int y,
+                                         int x_begin, int x_end, int radius, BorderMode border,
+                                         std::vector<unsigned char> &padded) {
+    const int sy = border_index(y, height, border);
+    if (sy >= 0 && x_begin - radius >= 0 && x_end + radius <= width) {
+        return input + static_cast<size_t>(sy) * width + x_begin - radius;
+    }
+
+    const int span = x_end - x_begin + 2 * radius;
+    unsigned char *row = grow(padded, span);
+    for (int k = 0; k < span; ++k) {
+        const int sx = border_index(x_begin - radius + k, width, border);
+        row[k] = (sy < 0 || sx < 0) ? 0 : input[static_cast<size_t>(sy) * width + sx];
+    }
+    return row;
+}
+
+/**
+ * Convolves one tile: the horizontal pass writes 16-bit rows for the tile and
+ * its vertical halo into the scratch buffer, the vertical pass accumulates them
+ * in 32 bit and normalises with one fixed-point multiply per pixel.
+ */
+static void convolve_tile(const unsigned char *input, unsigned char *output, int width, int height,
+                          const SeparableKernel &horizontal, const SeparableKernel &vertical,
+                          BorderMode border, int x_begin, int x_end, int y_begin, int y_end,
+                          ConvolutionScratch &scratch) {
+    const int rx = static_cast<int>(horizontal.taps.size()) / 2;
+    const int ry = static_cast<int>(vertical.taps.size()) / 2;
+    const int tile_width = x_end - x_begin;
+    const int rows = y_end - y_begin + 2 * ry;
+
+    uint16_t *mid = grow(scratch.rows, static_cast<size_t>(rows) * tile_width);
+    uint32_t *acc = grow(scratch.acc, tile_width);
+
+    // Horizontal pass over the tile rows and the vertical halo
+    for (int r = 0; r < rows; ++r) {
+        const unsigned char *src = bordered_row(input, width, height, y_begin - ry + r,
+                                                x_begin, x_end, rx, border, scratch.padded);
+        uint16_t *dst = mid + static_cast<size_t>(r) * tile_width;
+        std::fill(dst, dst + tile_width, 0);
+        for (size_t k = 0; k < horizontal.taps.size(); ++k) {
+            const uint16_t t = horizontal.taps[k];
+            if (!t) continue;
+            const unsigned char *s = src + k;
+            #pragma omp simd
+            for (int x = 0; x < tile_width; ++x) {
+                dst[x] += t * s[x];
+            }
+        }
+    }
+
+    // Vertical pass; (acc + D/2) * ceil(2^48 / D) >> 48 equals round(acc / D) for acc < 2^25
+    const uint64_t divisor = static_cast<uint64_t>(std::accumulate(horizontal.taps.begin(), horizontal.taps.end(), 0)) *
+                             std::accumulate(vertical.taps.begin(), vertical.taps.end(), 0);
+    const uint64_t scale = ((uint64_t{1} << NORM_SHIFT) + divisor - 1) / divisor;
+    const uint32_t bias = static_cast<uint32_t>(divisor / 2);
+
+    for (int y = y_begin; y < y_end; ++y) {
+        std::fill(acc, acc + tile_width, bias);
+        for (size_t k = 0; k < vertical.taps.size(); ++k) {
+            const uint32_t t = vertical.taps[k];
+            if (!t) continue;
+            const uint16_t *s = mid + static_cast<size_t>(y - y_begin + k) * tile_width;
+            #pragma omp simd
+            for (int x = 0; x < tile_width; ++x) {
+                acc[x] += t * s[x];
+            }
+        }
+        unsigned char *out = output + static_cast<size_t>(y) * width + x_begin;
+        #pragma omp simd
+        for (int x = 0; x < tile_width; ++x) {
+            out[x] = static_cast<unsigned char>((acc[x] * scale) >> NORM_SHIFT);
+        }
+    }
+}
+
+static bool valid_kernel(const SeparableKernel &kernel) {
+    const int sum = std::accumulate(kernel.taps.begin(), kernel.taps.end(), 0);
+    return kernel.taps.size() % 2 == 1 && sum > 0 && sum <= MAX_KERNEL_SUM;
+}
+
+/**
+ * Runs a tile function over the image. Tiles are handed out dynamically so that
+ * border tiles (which need bordered copies of their rows) do not stall a thread.
+ */
+template <typename TileFunc>
+static void for_each_tile(int width, int height, TileFunc tile_func) {
+    const int tile_rows = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+    const int tile_cols = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+    const int tiles = tile_rows * tile_cols;
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int tile = 0; tile < tiles; ++tile) {
+        TraceSpan span("convolution_tile");
+        const int ty = tile / tile_cols;
+        const int tx = tile % tile_cols;
+        tile_func(tx * TILE_WIDTH, std::min(width, (tx + 1) * TILE_WIDTH),
+                  ty * TILE_HEIGHT, std::min(height, (ty + 1) * TILE_HEIGHT), thread_scratch());
+    }
+}
+
+/**
+ * Separable convolution of one 8-bit plane with non-negative fixed-point kernels.
+ * The result is rounded to the nearest integer.
+ *
+ * @param input Input plane (width x height), must not alias output.
+ * @param output Output plane (width x height).
+ * @param horizontal Kernel applied along the rows.
+ * @param vertical Kernel applied along the columns.
+ * @param border Border handling outside the image.
+ */
+void convolve_separable(const unsigned char *input, unsigned char *output, int width, int height,
+                        const SeparableKernel &horizontal, const SeparableKernel &vertical,
+                        BorderMode border) {
+    if (!valid_kernel(horizontal) || !valid_kernel(vertical)) {
+        spdlog::error("[convolution] Kernels must have odd length and a weight sum in [1, {}]", MAX_KERNEL_SUM);
+        return;
+    }
+    for_each_tile(width, height, [&](int x0, int x1, int y0, int y1, ConvolutionScratch &scratch) {
+        convolve_tile(input, output, width, height, horizontal, vertical, border, x0, x1, y0, y1, scratch);
+    });
+}
+
+void gaussian_blur(const unsigned char *input, unsigned char *output, int width, int height,
+                   float sigma, BorderMode border) {
+    const SeparableKernel kernel = gaussian_kernel(sigma);
+    convolve_separable(input, output, width, height, kernel, kernel, border);
+}
+
+void box_blur(const unsigned char *input, unsigned char *output, int width, int height,
+              int size, BorderMode border) {
+    const SeparableKernel kernel = box_kernel(size);
+    convolve_separable(input, output, width, height, kernel, kernel, border);
+}
+
+/**
+ * Sobel gradient magnitude of one tile. The horizontal pass stores the
+ * derivative [-1 0 1] and the smoothing [1 2 1] of every row in 16 bit; the
+ * vertical pass combines them into gx and gy. The magnitude uses the L1 norm,
+ * so no square root is needed.
+ */
+static void sobel_tile(const unsigned char *input, unsigned char *output, int width, int height,
+                       BorderMode border, int x_begin, int x_end, int y_begin, int y_end,
+                       ConvolutionScratch &scratch) {
+    const int tile_width = x_end - x_begin;
+    const int rows = y_end - y_begin + 2;
+    const size_t plane = static_cast<size_t>(rows) * tile_width;
+
+    // Reuses the 16-bit row buffer for the signed derivative rows
+    int16_t *dx = reinterpret_cast<int16_t *>(grow(scratch.rows, plane));
+    int16_t *sm = grow(scratch.rows_dy, plane);
+
+    for (int r = 0; r < rows; ++r) {
+        const unsigned char *src = bordered_row(input, width, height, y_begin - 1 + r,
+                                                x_begin, x_end, 1, border, scratch.padded);
+        int16_t *d = dx + static_cast<size_t>(r) * tile_width;
+        int16_t *s = sm + static_cast<size_t>(r) * tile_width;
+        #pragma omp simd
+        for (int x = 0; x < tile_width; ++x) {
+            d[x] = static_cast<int16_t>(src[x + 2] - src[x]);
+            s[x] = static_cast<int16_t>(src[x] + 2 * src[x + 1] + src[x + 2]);
+        }
+    }
+
+    for (int y = y_begin; y < y_end; ++y) {
+        const size_t r = static_cast<size_t>(y - y_begin) * tile_width;
+        const int16_t *d0 = dx + r, *d1 = d0 + tile_width, *d2 = d1 + tile_width;
+        const int16_t *s0 = sm + r, *s2 = s0 + 2 * tile_width;
+        unsigned char *out = output + static_cast<size_t>(y) * width + x_begin;
+        #pragma omp simd
+        for (int x = 0; x < tile_width; ++x) {
+            const int gx = d0[x] + 2 * d1[x] + d2[x];
+            const int gy = s2[x] - s0[x];
+            out[x] = static_cast<unsigned char>(std::min(255, (std::abs(gx) + std::abs(gy)) >> 2));
+        }
+    }
+}
+
+/**
+ * Sobel gradient magnitude of one 8-bit plane.
+ *
+ * @param input Input plane (width x height), must not alias output.
+ * @param output Output plane, min(255, (|gx| + |gy|) / 4).
+ * @param border Border handling outside the image.
+ */
+void sobel_magnitude(const unsigned char *input, unsigned char *output, int width, int height,
+                     BorderMode border) {
+    for_each_tile(width, height, [&](int x0, int x1, int y0, int y1, ConvolutionScratch &scratch) {
+        sobel_tile(input, output, width, height, border, x0, x1, y0, y1, scratch);
+    });
+}
+
+/**
+ * Loads an image, applies the Gaussian, box or Sobel filter and writes the result.
+ *
+ * @param input_path Path to the input image.
+ * @param output_path Output path; generated from the input path and method if empty.
+ * @param method "gaussian", "box" or "sobel".
+ * @param sigma Standard deviation of the Gaussian.
+ * @param size Box kernel size.
+ * @param border Border handling outside the image.
+ * @param color Filter R, G and B separately instead of the grayscale image (not for sobel).
+ */
+void process_convolution(const std::string &input_path, std::string output_path, const std::string &method,
+                         float sigma, int size, BorderMode border, bool color) {
+    spdlog::info("process_convolution Starting {} on: {} (sigma: {}, size: {}, border: {}, color: {})",
+                 method, input_path, sigma, size, border_mode_name(border), color);
+    PerfJob job(method);
+
+    int width, height, channels;
+    unsigned char *image = load_image<unsigned char>(input_path, width, height, channels);
+    if (!image) {
+        spdlog::error("[process_convolution] Failed to load image: {}", input_path);
+        return;
+    }
+
+    if (output_path.empty()) {
+        output_path = make_output_path(input_path, method);
+    }
+
+    if (color && (channels < 3 || method == "sobel")) {
+        spdlog::warn("[process_convolution] Colour mode not available here, filtering as grayscale");
+        color = false;
+    }
+
+    const int pixels = width * height;
+    const int filtered_channels = color ? 3 : 1;
+    const int output_channels = color ? channels : 1;
+
+    // Planar input: either the gray image or one plane per colour channel
+    std::vector<Plane<unsigned char>> planes;
+    for (int c = 0; c < filtered_channels; ++c) planes.emplace_back(pixels);
+    PerfStage gray_stage("gray", pixels, color ? "rgb planes" : "");
+    if (color) {
+#pragma omp parallel for
+        for (int i = 0; i < pixels; ++i) {
+            planes[0][i] = image[i * channels + 0];
+            planes[1][i] = image[i * channels + 1];
+            planes[2][i] = image[i * channels + 2];
+        }
+    } else if (channels < 3) {
+#pragma omp parallel for
+        for (int i = 0; i < pixels; ++i) {
+            planes[0][i] = image[i * channels];
+        }
+    } else {
+        Plane<unsigned char> &gray = planes[0];
+#pragma omp parallel for simd
+        for (int i = 0; i < pixels; ++i) {
+            gray[i] = static_cast<unsigned char>(
+                0.2126f * image[i * channels + 0] +
+                0.7152f * image[i * channels + 1] +
+                0.0722f * image[i * channels + 2]);
+        }
+    }
+
+    gray_stage.stop();
+
+    PerfStage filter_stage("filter", pixels, method);
+    std::vector<Plane<unsigned char>> filtered;
+    for (int c = 0; c < filtered_channels; ++c) filtered.emplace_back(pixels);
+    for (int c = 0; c < filtered_channels; ++c) {
+        if (method == "gaussian") {
+            gaussian_blur(planes[c].data(), filtered[c].data(), width, height, sigma, border);
+        } else if (method == "box") {
+            box_blur(planes[c].data(), filtered[c].data(), width, height, size, border);
+        } else {
+            sobel_magnitude(planes[c].data(), filtered[c].data(), width, height, border);
+        }
+    }
+
+    const double filter_seconds = filter_stage.stop();
+
+    // Re-interleave only for the output; an alpha channel is passed through
+    Plane<unsigned char> output;
+    if (color) {
+        output = Plane<unsigned char>(static_cast<size_t>(pixels) * output_channels);
+#pragma omp parallel for
+        for (int i = 0; i < pixels; ++i) {
+            output[i * output_channels + 0] = filtered[0][i];
+            output[i * output_channels + 1] = filtered[1][i];
+            output[i * output_channels + 2] = filtered[2][i];
+            for (int c = 3; c < output_channels; ++c) {
+                output[i * output_channels + c] = image[i * channels + c];
+            }
+        }
+    } else {
+        output = std::move(filtered[0]);
+    }
+
+    if (!write_binary_image(output_path, width, height, output_channels, output.data())) {
+        spdlog::error("[process_convolution] Failed to write filtered image: {}", output_path);
+    } else {
+        spdlog::info("[process_convolution] Filtered image saved to: {}", output_path);
+    }
+
+    stbi_image_free(image);
+
+    spdlog::info("process_convolution {} filter time: {} seconds", method, filter_seconds);
+}
@@ -8,6 +8,7 @@
  *  - Advanced binarization (Sauvola, Nick)
  *  - Integral binarization
  *  - Adaptive median filtering
+ *  - Separable convolution filters (Gaussian, box, Sobel)
  *  - Running all available methods
  *
  * The program accepts command-line arguments to specify input/output paths,
@@ -22,54 +23,130 @@
  */
 
 #include <iostream>  // Standard library for input and output operations
+#include <ostream>   // Console stream (stdout or stderr) for messages
 #include <string>    // Standard string library for handling strings
+#include <sstream>   // String streams for splitting list arguments
+#include <vector>    // Dynamic arrays for list arguments
 
 // Including custom header files for different binarization and filtering methods
 #include "binarization/thresholding.h"
 #include "binarization/adaptive_thresholding.h"
 #include "binarization/integral_binarization.h"
 #include "filters/adaptive_median_filter.h"
+#include "filters/convolution.h"
+#include "pipeline/all_methods.h"
+#include "binarization/engine_autotune.h"
+#include "utils/perf_report.h"
+#include "utils/trace.h"
+#include "utils/perf_counters.h"
+#include "utils/numa.h"
+#include "utils/plane_arena.h"
+#include "utils/image_io.h"
 
 // Including external logging library (spdlog) for logging messages
 #include "../external/spdlog/include/spdlog/spdlog.h"
 #include "../external/spdlog/include/spdlog/sinks/basic_file_sink.h"
+#include "../external/spdlog/include/spdlog/async.h"
+
+// Parses a comma-separated list of window sizes, e.g. "15" or "15,31,61"
+std::vector<int> parseWindowSizes(const std::string &value) {
+    std::vector<int> sizes;
+    std::stringstream ss(value);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        int size = std::stoi(item);
+        if (size <= 0) {
+            throw std::invalid_argument("window size must be positive");
+        }
+        sizes.push_back(size);
+    }
+    if (sizes.empty()) {
+        throw std::invalid_argument("empty window size list");
+    }
+    return sizes;
+}
 
 // Function to display help information on how to use the program
-void printHelp() {
-    std::cout << "\nImage Processing Tool\n\n";
-    std::cout << "Usage:\n";
-    std::cout << "  ./image_processor --input <input> --method <method> [options]\n\n";
-
-    std::cout << "Required arguments:\n";
-    std::cout << "  -i, --input <path>    Input image file path\n";
-    std::cout << "  -m, --method <name>   Processing method to use:\n";
-    std::cout << "                        (sequential, parallel, advanced, integral, adaptive_median, all)\n\n";
-
-    std::cout << "Options:\n";
-    std::cout << "  -o, --output <path>   Output file path (required for some methods)\n";
-    std::cout << "  -t, --threshold <num> Threshold value (default: 128)\n";
-    std::cout << "  -h, --help            Show this help message\n\n";
-    std::cout << "  -w, --window_size <num>  Kernel size for adaptive methods (default: 15)\n";
-    std::cout << "  --k <num>               Parameter k for Sauvola/Nick (default: 0.2)\n";
-    std::cout << "  --R <num>               Dynamic range R for Sauvola (default: 128.0)\n";
+void printHelp(std::ostream &out) {
+    out << "\nImage Processing Tool\n\n";
+    out << "Usage:\n";
+    out << "  ./image_processor --input <input> --method <method> [options]\n\n";
+
+    out << "Required arguments:\n";
+    out << "  -i, --input <path>    Input image file path (- reads from stdin)\n";
+    out << "  -m, --method <name>   Processing method to use:\n";
+    out << "                        (sequential, parallel, advanced, integral, adaptive_median,\n";
+    out << "                        gaussian, box, sobel, all)\n\n";
+
+    out << "Options:\n";
+    out << "  -o, --output <path>   Output file path (- writes all results to stdout)\n";
+    out << "  -t, --threshold <num> Threshold value (default: 128)\n";
+    out << "  -h, --help            Show this help message\n\n";
+    out << "  -w, --window_size <num>  Kernel size for adaptive methods (default: 15)\n";
+    out << "                           integral accepts a list (e.g. 15,31,61) sharing one integral image\n";
+    out << "  --k <num>               Parameter k for Sauvola/Nick (default: 0.2)\n";
+    out << "  --R <num>               Dynamic range R for Sauvola (default: 128.0)\n";
+    out << "  --engine <name>         Statistics engine for advanced: naive, integral, auto (default: naive)\n";
+    out << "  --calibration <path>    Cost table for --engine auto (default: engine_calibration.txt)\n";
+    out << "  --calibrate             Re-run the engine calibration before processing\n";
+    out << "  --color                 adaptive_median: filter R, G, B separately and keep colour\n";
+    out << "  --impulse_map           adaptive_median: only filter detected impulse candidates\n";
+    out << "  --sigma <num>           gaussian: standard deviation in pixels (default: 1.0)\n";
+    out << "  --border <name>         gaussian/box/sobel: replicate, reflect, constant (default: replicate)\n";
+    out << "                          box uses -w as kernel size; --color also applies to gaussian and box\n";
+    out << "  --morph <op>            advanced/integral: erode, dilate, open, close on the ink (default: none)\n";
+    out << "  --se <WxH>              Structuring element for --morph, e.g. 3x3 or 5 (default: 3x3)\n";
+    out << "  --components            advanced/integral: write connected-component statistics (CSV)\n";
+    out << "  --min_area <num>        advanced/integral: remove components smaller than num pixels\n";
+    out << "  --deskew                advanced/integral: straighten the page before binarization\n";
+    out << "  --max_skew <deg>        Largest skew searched by --deskew (default: 5; implies --deskew)\n";
+    out << "  --report <path>         Write per-stage timings, MPix/s, threads, peak RSS and allocations as JSON\n";
+    out << "  --trace <path>          Record per-thread spans and write them as a Chrome/Perfetto trace (JSON)\n";
+    out << "  --counters              Log cycles, IPC, LLC and branch misses per stage (Linux perf_event_open)\n";
+    out << "  --bind <policy>         Pin OpenMP threads: none, close (fill one socket first), spread (default: none)\n";
+    out << "                          ignored with -m all\n";
+    out << "  --huge_pages <mode>     Back image planes of 2 MB and more with huge pages: off, thp, explicit (default: off)\n";
+    out << "  --format <name>         Image format on stdout with -o -: png, jpg, pnm (default: png)\n";
+    out << "                          -i - reads PNM, PNG or JPEG from stdin; messages then go to stderr\n";
 
     // Examples of command-line usage
-    std::cout << "Examples:\n";
-    std::cout << "  Basic thresholding:     ./image_processor -i input.jpg -o out.jpg -m sequential -t 150\n";
-    std::cout << "  Sauvola and Nick binarization:   ./image_processor --input in.png --method advanced\n";
-    std::cout << "  Run all methods:        ./image_processor -i image.ppm -o results/ -m all\n";
-    std::cout << "  Show help:              ./image_processor --help\n";
+    out << "Examples:\n";
+    out << "  Basic thresholding:     ./image_processor -i input.jpg -o out.jpg -m sequential -t 150\n";
+    out << "  Sauvola and Nick binarization:   ./image_processor --input in.png --method advanced\n";
+    out << "  Run all methods:        ./image_processor -i image.ppm -o results/ -m all\n";
+    out << "  Pipeline:               curl -s URL | ./image_processor -i - -o - -m advanced --format pnm | pnmtopng\n";
+    out << "  Show help:              ./image_processor --help\n";
 }
 
 // Main function, entry point of the program
 int main(int argc, char *argv[]) {
-    std::cout << "Program started, writing to output.log!" << std::endl;
+    // Drains the asynchronous log queue on every return path
+    struct LogShutdown {
+        ~LogShutdown() { spdlog::shutdown(); }
+    } log_shutdown;
+
+    // With -o - stdout carries the image stream, so console messages go to stderr
+    bool stdout_stream = false;
+    for (int i = 1; i + 1 < argc; ++i) {
+        const std::string arg = argv[i];
+        if ((arg == "--output" || arg == "-o") && is_stdio_path(argv[i + 1])) {
+            stdout_stream = true;
+        }
+    }
+    std::ostream &console = stdout_stream ? std::cerr : std::cout;
+
+    console << "Program started, writing to output.log!" << std::endl;
 
     try {
-        // Initializing the logger to write logs to "logs/output.log"
-        auto logger = spdlog::basic_logger_mt("file_logger", "logs/output.log");
+        // Initializing the logger to write logs to "logs/output.log". Messages are
+        // formatted on the calling thread but written by one background thread, so
+        // processing threads never wait for the file.
+        spdlog::init_thread_pool(8192, 1);
+        auto logger = spdlog::basic_logger_mt<spdlog::async_factory>("file_logger", "logs/output.log");
+        logger->flush_on(spdlog::level::err);
         spdlog::set_default_logger(logger);
-        spdlog::set_level(spdlog::level::info);
+        // Levels below SPDLOG_ACTIVE_LEVEL (CMake option LOG_LEVEL) are compiled out
+        spdlog::set_level(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
         spdlog::info("\n\n***** Program started *****\n\n");
 
         // Variables to store input parameters
@@ -78,8 +155,24 @@ int main(int argc, char *argv[]) {
         std::string method;
         int threshold = 128;   // Default threshold value
         int window_size = 15;  // Default window size for adaptive methods
+        std::vector<int> window_sizes = {window_size}; // All window sizes (integral method)
         float k = 0.2f;        // Default parameter k for Sauvola/Nick
         float R = 128.0f;      // Default dynamic range R for Sauvola
+        BinarizationEngine engine = BinarizationEngine::Naive;       // Statistics engine for advanced
+        std::string calibration_path = DEFAULT_CALIBRATION_PATH;     // Cost table for --engine auto
+        bool calibrate = false;                                      // Force a new calibration run
+        bool color = false;                                          // Colour mode for adaptive_median
+        bool impulse_map = false;                                    // Impulse pre-detection for adaptive_median
+        float sigma = 1.0f;                                          // Gaussian standard deviation
+        BorderMode border = BorderMode::Replicate;                   // Border handling for convolution filters
+        PostprocessOptions postprocess;                              // Post-processing of advanced/integral outputs
+        float max_skew = 0.0f;                                       // Deskew range in degrees (0 = off)
+        std::string report_path;                                     // JSON performance report (empty = off)
+        std::string trace_path;                                      // Chrome trace output (empty = off)
+        bool counters = false;                                       // Hardware counters per stage
+        ThreadBinding binding = ThreadBinding::None;                 // Thread pinning (none = OpenMP runtime)
+        HugePages huge_pages = HugePages::Off;                       // Page size for large image planes
+        StreamFormat stream_format = StreamFormat::Png;              // Image format on stdout (-o -)
 
         // Parsing command line arguments
         for (int i = 1; i < argc; ++i) {
@@ -87,7 +180,7 @@ int main(int argc, char *argv[]) {
 
             // Show help message and exit
             if (arg == "--help" || arg == "-h") {
-                printHelp();
+                printHelp(console);
                 return 0;
             }
             // Input file path
@@ -96,7 +189,7 @@ int main(int argc, char *argv[]) {
                     input_path = argv[++i];
                 } else {
                     spdlog::error("Missing value for --input");
-                    std::cout << "Missing input!" << std::endl;
+                    console << "Missing input!" << std::endl;
                     return 1;
                 }
             }
@@ -106,7 +199,7 @@ int main(int argc, char *argv[]) {
                     output_path = argv[++i];
                 } else {
                     spdlog::error("Missing value for --output");
-                    std::cout << "Missing output!" << std::endl;
+                    console << "Missing output!" << std::endl;
                     return 1;
                 }
             }
@@ -116,7 +209,7 @@ int main(int argc, char *argv[]) {
                     method = argv[++i];
                 } else {
                     spdlog::error("Missing value for --method");
-                    std::cout << "Missing method!" << std::endl;
+                    console << "Missing method!" << std::endl;
                     return 1;
                 }
             }
@@ -131,7 +224,7 @@ int main(int argc, char *argv[]) {
                     }
                 } else {
                     spdlog::error("Missing value for --threshold");
-                    std::cout << "Missing threshold!" << std::endl;
+                    console << "Missing threshold!" << std::endl;
                     return 1;
                 }
             }
@@ -139,7 +232,8 @@ int main(int argc, char *argv[]) {
             else if (arg == "--window_size" || arg == "-w") {
                 if (i + 1 < argc) {
                     try {
-                        window_size = std::stoi(argv[++i]);
+                        window_sizes = parseWindowSizes(argv[++i]);
+                        window_size = window_sizes.front();
                     } catch (const std::exception& e) {
                         spdlog::error("Invalid window_size value: {}", e.what());
                         return 1;
@@ -177,10 +271,187 @@ int main(int argc, char *argv[]) {
                     return 1;
                 }
             }
+            // Statistics engine for Sauvola/Nick
+            else if (arg == "--engine") {
+                if (i + 1 < argc) {
+                    if (!parse_engine(argv[++i], engine)) {
+                        spdlog::error("Invalid engine: {}", argv[i]);
+                        return 1;
+                    }
+                } else {
+                    spdlog::error("Missing value for --engine");
+                    return 1;
+                }
+            }
+            // Calibration file for the auto engine
+            else if (arg == "--calibration") {
+                if (i + 1 < argc) {
+                    calibration_path = argv[++i];
+                } else {
+                    spdlog::error("Missing value for --calibration");
+                    return 1;
+                }
+            }
+            // Force re-calibration
+            else if (arg == "--calibrate") {
+                calibrate = true;
+            }
+            // Per-channel colour filtering
+            else if (arg == "--color") {
+                color = true;
+            }
+            // Impulse noise pre-detection
+            else if (arg == "--impulse_map") {
+                impulse_map = true;
+            }
+            // Standard deviation of the Gaussian filter
+            else if (arg == "--sigma") {
+                if (i + 1 < argc) {
+                    try {
+                        sigma = std::stof(argv[++i]);
+                    } catch (const std::exception& e) {
+                        spdlog::error("Invalid sigma value: {}", e.what());
+                        return 1;
+                    }
+                } else {
+                    spdlog::error("Missing value for --sigma");
+                    return 1;
+                }
+            }
+            // Border handling for convolution filters
+            else if (arg == "--border") {
+                if (i + 1 < argc) {
+                    if (!parse_border_mode(argv[++i], border)) {
+                        spdlog::error("Invalid border mode: {}", argv[i]);
+                        return 1;
+                    }
+                } else {
+                    spdlog::error("Missing value for --border");
+                    return 1;
+                }
+            }
+            // Morphological post-processing of binarized outputs
+            else if (arg == "--morph") {
+                if (i + 1 < argc) {
+                    if (!parse_morphology_op(argv[++i], postprocess.morphology.op)) {
+                        spdlog::error("Invalid morphology operation: {}", argv[i]);
+                        return 1;
+                    }
+                } else {
+                    spdlog::error("Missing value for --morph");
+                    return 1;
+                }
+            }
+            // Structuring element size
+            else if (arg == "--se") {
+                if (i + 1 < argc) {
+                    if (!parse_structuring_element(argv[++i], postprocess.morphology.width, postprocess.morphology.height)) {
+                        spdlog::error("Invalid structuring element: {}", argv[i]);
+                        return 1;
+                    }
+                } else {
+                    spdlog::error("Missing value for --se");
+                    return 1;
+                }
+            }
+            // Connected-component statistics
+            else if (arg == "--components") {
+                postprocess.component_stats = true;
+            }
+            // Minimum component area
+            else if (arg == "--min_area") {
+                if (i + 1 < argc) {
+                    try {
+                        postprocess.min_area = std::stoll(argv[++i]);
+                    } catch (const std::exception& e) {
+                        spdlog::error("Invalid min_area value: {}", e.what());
+                        return 1;
+                    }
+                } else {
+                    spdlog::error("Missing value for --min_area");
+                    return 1;
+                }
+            }
+            // Deskew before binarization
+            else if (arg == "--deskew") {
+                if (max_skew <= 0.0f) max_skew = 5.0f;
+            }
+            // Largest skew angle searched by --deskew
+            else if (arg == "--max_skew") {
+                if (i + 1 < argc) {
+                    try {
+                        max_skew = std::stof(argv[++i]);
+                    } catch (const std::exception& e) {
+                        spdlog::error("Invalid max_skew value: {}", e.what());
+                        return 1;
+                    }
+                } else {
+                    spdlog::error("Missing value for --max_skew");
+                    return 1;
+                }
+            }
+            // Per-stage performance report
+            else if (arg == "--report") {
+                if (i + 1 < argc) {
+                    report_path = argv[++i];
+                } else {
+                    spdlog::error("Missing value for --report");
+                    return 1;
+                }
+            }
+            // Per-thread trace spans
+            else if (arg == "--trace") {
+                if (i + 1 < argc) {
+                    trace_path = argv[++i];
+                } else {
+                    spdlog::error("Missing value for --trace");
+                    return 1;
+                }
+            }
+            // Hardware performance counters
+            else if (arg == "--counters") {
+                counters = true;
+            }
+            // Thread pinning
+            else if (arg == "--bind") {
+                if (i + 1 < argc) {
+                    if (!parse_thread_binding(argv[++i], binding)) {
+                        spdlog::error("Invalid binding: {} (none, close, spread)", argv[i]);
+                        return 1;
+                    }
+                } else {
+                    spdlog::error("Missing value for --bind");
+                    return 1;
+                }
+            }
+            // Huge pages for image planes
+            else if (arg == "--huge_pages") {
+                if (i + 1 < argc) {
+                    if (!parse_huge_pages(argv[++i], huge_pages)) {
+                        spdlog::error("Invalid huge page mode: {} (off, thp, explicit)", argv[i]);
+                        return 1;
+                    }
+                } else {
+                    spdlog::error("Missing value for --huge_pages");
+                    return 1;
+                }
+            }
+            // Image format for stdout output
+            else if (arg == "--format") {
+                if (i + 1 < argc) {
+                    if (!parse_stream_format(argv[++i], stream_format)) {
+                        spdlog::error("Invalid format: {} (png, jpg, pnm)", argv[i]);
+                        return 1;
+                    }
+                } else {
+                    spdlog::error("Missing value for --format");
+                    return 1;
+                }
+            }
             // Unknown argument handling
             else {
                 spdlog::error("Unknown argument: {}", arg);
-                std::cout << "Unknown arguments!" << std::endl;
+                console << "Unknown arguments!" << std::endl;
                 return 1;
             }
         }
@@ -188,17 +459,18 @@ int main(int argc, char *argv[]) {
         // Ensure required arguments are provided
         if (input_path.empty()) {
             spdlog::error("Input path is required (use --input)");
-            printHelp();
+            printHelp(console);
             return 1;
         }
         if (method.empty()) {
             spdlog::error("Method is required (use --method)");
-            printHelp();
+            printHelp(console);
             return 1;
         }
 
         // Validate the method name
-        const std::string valid_methods[] = {"sequential", "parallel", "advanced", "integral", "adaptive_median", "all"};
+        const std::string valid_methods[] = {"sequential", "parallel", "advanced", "integral", "adaptive_median",
+                                         "gaussian", "box", "sobel", "all"};
         bool valid = false;
         for (const auto& m : valid_methods) {
             if (method == m) {
@@ -211,6 +483,49 @@ int main(int argc, char *argv[]) {
             return 1;
         }
 
+        // Streaming: every result goes to stdout one after the other. The methods of -m all
+        // finish in no fixed order, so their images could not be told apart in the stream.
+        if (is_stdio_path(output_path)) {
+            if (method == "all") {
+                spdlog::error("-o - is not supported with -m all, use a single method");
+                console << "-o - is not supported with -m all!" << std::endl;
+                return 1;
+            }
+            set_stdout_output(true);
+            set_stream_format(stream_format);
+            spdlog::info("Writing results to stdout as {}", stream_format_name(stream_format));
+        }
+
+        // The task graph of -m all runs its kernels in nested teams. Their threads inherit the
+        // one-CPU mask of the pinned pool thread that creates them, so a node would run on one core.
+        if (binding != ThreadBinding::None && method == "all") {
+            spdlog::warn("--bind is ignored with -m all: nested task teams would inherit one-CPU masks");
+            binding = ThreadBinding::None;
+        }
+
+        // Pin before anything touches image buffers, so first touch lands on the final nodes
+        if (binding != ThreadBinding::None) {
+            bind_threads(binding);
+        }
+        log_thread_placement();
+        set_huge_pages(huge_pages);
+
+        if (!report_path.empty()) {
+            perf_report_enable(input_path, method);
+        }
+        if (!trace_path.empty()) {
+            trace_enable();
+        }
+        // Without permission the run continues without counters (warning in the log)
+        if (counters) {
+            perf_counters_enable();
+        }
+
+        // Refresh the engine cost table if requested
+        if (calibrate && !calibrate_engines(calibration_path)) {
+            return 1;
+        }
+
         // Execute the selected processing method
         if (method == "sequential") {
             binarize_image(input_path, output_path, threshold);
@@ -219,25 +534,50 @@ int main(int argc, char *argv[]) {
             binarize_image_parallel(input_path, output_path, threshold);
         }
         else if (method == "advanced") {
-            process_advanced_binarization(input_path, window_size, k, R);
+            process_advanced_binarization(input_path, window_size, k, R, engine, calibration_path, postprocess, max_skew);
         }
         else if (method == "integral") {
-            process_integral_binarization(input_path, window_size, k, R);
+            process_integral_binarization(input_path, window_sizes, k, R, postprocess, max_skew);
         }
         else if (method == "adaptive_median") {
-            adaptive_median_filter(input_path, output_path);
+            adaptive_median_filter(input_path, output_path, color, impulse_map);
+        }
+        else if (method == "gaussian" || method == "box" || method == "sobel") {
+            process_convolution(input_path, output_path, method, sigma, window_size, border, color);
         }
         else if (method == "all") {
-            binarize_image_parallel(input_path, output_path, threshold);
-            process_advanced_binarization(input_path, window_size, k, R);
-            process_integral_binarization(input_path, window_size, k, R);
-            adaptive_median_filter(input_path, output_path);
+            // One decode and gray conversion, then the methods run side by side as a task graph
+            AllMethodsOptions options;
+            options.output_path = output_path;
+            options.threshold = threshold;
+            options.window_size = window_size;
+            options.window_sizes = window_sizes;
+            options.k = k;
+            options.R = R;
+            options.engine = engine;
+            options.calibration_path = calibration_path;
+            options.postprocess = postprocess;
+            options.max_skew = max_skew;
+            options.color = color;
+            options.impulse_map = impulse_map;
+            process_all_methods(input_path, options);
+        }
+
+        log_plane_arena_stats();
+
+        if (!report_path.empty() && !perf_report_write(report_path)) {
+            console << "Failed to write report!" << std::endl;
+            return 1;
+        }
+        if (!trace_path.empty() && !trace_write_chrome(trace_path)) {
+            console << "Failed to write trace!" << std::endl;
+            return 1;
         }
 
         spdlog::info("***** Program finished successfully *****\n\n");
     } catch (const std::exception &e) {
         spdlog::critical("Unhandled exception: {}", e.what());
-        printHelp();
+        printHelp(console);
         return 1;
     }
 
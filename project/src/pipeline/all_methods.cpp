@@ -0,0 +1,142 @@
+#include <pipeline/all_methods.h>
+#include <binarization/adaptive_thresholding.h>
+#include <binarization/deskew.h>
+#include <binarization/integral_binarization.h>
+#include <binarization/thresholding.h>
+#include <filters/adaptive_median_filter.h>
+#include <utils/image_io.h>
+#include <utils/numa.h>
+#include <utils/perf_report.h>
+#include <utils/plane_arena.h>
+#include <utils/task_graph.h>
+#include <algorithm>
+#include <omp.h>
+#include <stb_image.h>
+#include <spdlog/spdlog.h>
+
+/**
+ * Builds and runs the dependency graph of -m all for one bit depth:
+ *
+ *   decode -> gray [-> deskew] -> sauvola, nick (integral engine: after integral_image)
+ *                              -> integral_image -> integral
+ *          -> gray             -> adaptive_median (colour mode: directly after decode)
+ *          -> parallel
+ *
+ * The image is decoded and converted to grayscale once. The deskewed plane is
+ * a copy, because the median filter works on the original page. When -o names
+ * a file, parallel and adaptive_median both write it; the filter then runs after
+ * the threshold so that its result is the one that remains, as before.
+ *
+ * @param engine Sauvola/Nick engine, resolved before the graph starts.
+ */
+template <typename Pixel>
+static void run_all_methods(const std::string &input_path, const AllMethodsOptions &options,
+                            const EngineChoice &engine) {
+    Pixel *image = nullptr;
+    int width = 0, height = 0, channels = 0;
+    Plane<Pixel> gray;
+    Plane<Pixel> straight;
+    BasicIntegralImage<Pixel> integral;
+
+    TaskGraph graph;
+    const int decode = graph.add("decode", [&] {
+        image = load_image<Pixel>(input_path, width, height, channels);
+        if (!image) spdlog::error("Failed to load image: {}", input_path);
+    });
+    const int to_gray = graph.add("gray", [&] {
+        if (!image) return;
+        const int64_t pixels = static_cast<int64_t>(width) * height;
+        gray = Plane<Pixel>(static_cast<size_t>(pixels));
+        PerfStage stage("gray", pixels);
+        convert_to_grayscale(image, channels, gray.data(), gray.size());
+        stage.stop();
+        log_page_placement("gray plane", gray.data(), gray.size() * sizeof(Pixel));
+    }, {decode});
+
+    // Plane the binarizations read: the gray plane or its deskewed copy
+    int binarization_input = to_gray;
+    auto binarization_gray = [&]() -> const Pixel * { return straight.empty() ? gray.data() : straight.data(); };
+    if (options.max_skew > 0.0f) {
+        binarization_input = graph.add("deskew", [&] {
+            if (!image) return;
+            const int64_t pixels = static_cast<int64_t>(width) * height;
+            straight = Plane<Pixel>(gray.size());
+            std::copy(gray.begin(), gray.end(), straight.begin());
+            PerfStage stage("deskew", pixels);
+            deskew_gray(straight.data(), width, height, options.max_skew);
+        }, {to_gray});
+    }
+
+    const int parallel = graph.add("parallel", [&] {
+        if (!image) return;
+        binarize_decoded_image(input_path, options.output_path, image, width, height, channels,
+                               options.threshold, true);
+    }, {decode});
+
+    const int integral_image = graph.add("integral_image", [&] {
+        if (!image) return;
+        PerfStage stage("statistics", static_cast<int64_t>(width) * height, "integral image");
+        integral.build(binarization_gray(), width, height);
+    }, {binarization_input});
+
+    // Sauvola and Nick are nodes of their own; with the integral engine they share the integral image
+    const bool use_integral = engine.engine == BinarizationEngine::Integral;
+    for (AdaptiveMethod method : {AdaptiveMethod::Sauvola, AdaptiveMethod::Nick}) {
+        graph.add(method == AdaptiveMethod::Sauvola ? "sauvola" : "nick", [&, method] {
+            if (!image) return;
+            ThreadLimit thread_limit(engine.threads);
+            adaptive_method_gray(input_path, method, binarization_gray(), width, height,
+                                 use_integral ? &integral : nullptr, options.window_size, options.k, options.R,
+                                 options.postprocess);
+        }, {use_integral ? integral_image : binarization_input});
+    }
+
+    // One window size after the other; each takes the node's share anew, so the
+    // threads of nodes that finished in the meantime join the next window
+    graph.add("integral", [&] {
+        if (!image) return;
+        for (int window_size : options.window_sizes) {
+            task_graph_rebalance();
+            integral_window_gray(input_path, integral, binarization_gray(), window_size,
+                                 options.window_sizes.size() > 1, options.k, options.R, options.postprocess);
+        }
+    }, {integral_image});
+
+    std::vector<int> median_deps = {options.color ? decode : to_gray};
+    if (!options.output_path.empty()) median_deps.push_back(parallel);
+    graph.add("adaptive_median", [&] {
+        if (!image) return;
+        adaptive_median_filter_decoded(input_path, options.output_path, image, width, height, channels,
+                                       options.color, options.impulse_map, options.color ? nullptr : gray.data());
+    }, median_deps);
+
+    graph.run();
+    stbi_image_free(image);
+}
+
+/**
+ * Runs parallel thresholding, Sauvola/Nick, integral Sauvola/Nick and the
+ * adaptive median filter on one image as a task graph (see run_all_methods).
+ * 16-bit images are processed at full precision.
+ *
+ * @param input_path Path to the input image file.
+ * @param options Parameters of the individual methods.
+ */
+void process_all_methods(const std::string &input_path, const AllMethodsOptions &options) {
+    spdlog::info("Processing all methods as a task graph for: {} ({} thread(s))", input_path, omp_get_max_threads());
+
+    // Resolve the engine (and calibrate if the table is missing) with the whole pool: inside the
+    // advanced node it would only see the node's share and measure under contention
+    EngineChoice engine{options.engine, omp_get_max_threads()};
+    int width = 0, height = 0, channels = 0;
+    if (read_image_info(input_path, width, height, channels)) {
+        engine = choose_engine(options.engine, width, height, options.window_size, options.calibration_path);
+    }
+
+    if (is_16bit_image(input_path)) {
+        spdlog::info("16-bit input, processing at full precision");
+        run_all_methods<uint16_t>(input_path, options, engine);
+    } else {
+        run_all_methods<unsigned char>(input_path, options, engine);
+    }
+}
@@ -1,12 +1,128 @@
 #include <utils/image_io.h>
+#include <utils/perf_report.h>
 #include <iostream>
 #include <fstream>
 #include <filesystem>
+#include <atomic>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
 #include <stb_image.h>
 #include <stb_image_write.h>
 #include <spdlog/spdlog.h>
 
+namespace {
+
+std::atomic<StreamFormat> g_stream_format{StreamFormat::Png};
+std::atomic<bool> g_stdout_output{false};
+
+/**
+ * Reads standard input to the end. The bytes are kept for the rest of the run,
+ * because the bit depth probe and the decoder both need them and a pipe can
+ * only be read once.
+ */
+const std::vector<unsigned char> &stdin_bytes() {
+    static const std::vector<unsigned char> bytes = [] {
+        std::vector<unsigned char> data;
+        unsigned char buffer[1 << 16];
+        size_t n;
+        while ((n = std::fread(buffer, 1, sizeof(buffer), stdin)) > 0) {
+            data.insert(data.end(), buffer, buffer + n);
+        }
+        spdlog::info("Read {} bytes from stdin", data.size());
+        return data;
+    }();
+    return bytes;
+}
+
+// Output callback of the stb_image_write *_to_func functions
+void write_to_stream(void *context, void *data, int size) {
+    static_cast<std::ostream *>(context)->write(static_cast<const char *>(data), size);
+}
+
+// Binary PGM (fewer than 3 channels: first channel) or PPM (RGB, alpha dropped), maxval 255 or 65535
+template <typename Sample>
+bool write_pnm(std::ostream &out, int width, int height, int channels, const Sample *data) {
+    constexpr int bytes = sizeof(Sample);
+    const int out_channels = channels >= 3 ? 3 : 1;
+    out << (out_channels == 3 ? "P6\n" : "P5\n") << width << " " << height << "\n"
+        << (bytes == 2 ? 65535 : 255) << "\n";
+    std::vector<unsigned char> row(static_cast<size_t>(width) * out_channels * bytes);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            for (int c = 0; c < out_channels; ++c) {
+                const Sample v = data[(static_cast<size_t>(y) * width + x) * channels + c];
+                unsigned char *dst = row.data() + bytes * (x * out_channels + c);
+                if constexpr (bytes == 2) {
+                    dst[0] = static_cast<unsigned char>(v >> 8);
+                    dst[1] = static_cast<unsigned char>(v & 0xFF);
+                } else {
+                    dst[0] = v;
+                }
+            }
+        }
+        out.write(reinterpret_cast<const char *>(row.data()), static_cast<std::streamsize>(row.size()));
+    }
+    return static_cast<bool>(out);
+}
+
+/**
+ * Writes an 8-bit image to stdout in the format chosen with --format and
+ * flushes it, so the next stage of a pipeline can start decoding right away.
+ */
+bool write_stdout_image(int width, int height, int channels, const unsigned char *data) {
+    bool success = false;
+    switch (g_stream_format.load()) {
+        case StreamFormat::Jpg:
+            success = stbi_write_jpg_to_func(write_to_stream, &std::cout, width, height, channels, data, 90);
+            break;
+        case StreamFormat::Pnm:
+            success = write_pnm(std::cout, width, height, channels, data);
+            break;
+        default:
+            success = stbi_write_png_to_func(write_to_stream, &std::cout, width, height, channels, data,
+                                             width * channels);
+            break;
+    }
+    std::cout.flush();
+    return success && static_cast<bool>(std::cout);
+}
+
+} // namespace
+
+bool is_stdio_path(const std::string &path) {
+    return path == "-";
+}
+
+bool parse_stream_format(const std::string &name, StreamFormat &format) {
+    if (name == "png") format = StreamFormat::Png;
+    else if (name == "jpg" || name == "jpeg") format = StreamFormat::Jpg;
+    else if (name == "pnm" || name == "pgm" || name == "ppm") format = StreamFormat::Pnm;
+    else return false;
+    return true;
+}
+
+const char *stream_format_name(StreamFormat format) {
+    switch (format) {
+        case StreamFormat::Jpg: return "jpg";
+        case StreamFormat::Pnm: return "pnm";
+        default: return "png";
+    }
+}
+
+void set_stream_format(StreamFormat format) {
+    g_stream_format.store(format);
+}
+
+void set_stdout_output(bool enabled) {
+    g_stdout_output.store(enabled);
+}
+
+bool stdout_output_enabled() {
+    return g_stdout_output.load();
+}
+
 // Hilfsfunktion zum Schreiben eines ASCII-PPM
 bool write_ppm_ascii(const std::string &filename, int width, int height, int channels, const unsigned char *data) {
     spdlog::info("Writing ASCII PPM file: {}", filename);
@@ -33,10 +149,17 @@ bool write_ppm_ascii(const std::string &filename, int width, int height, int cha
 
 std::string make_output_path(const std::string &input_path, const std::string &methodName) {
     spdlog::info("Creating output path for input: {}", input_path);
+    if (stdout_output_enabled()) {
+        return "-";
+    }
     namespace fs = std::filesystem;
     fs::path p(input_path);
     std::string stem = p.stem().string();
     std::string ext = p.extension().string();
+    if (is_stdio_path(input_path)) {
+        stem = "stdin";
+        ext = ".png";
+    }
 
     fs::path results_dir = "Results";
     if (!fs::exists(results_dir)) {
@@ -56,13 +179,16 @@ std::string make_output_path(const std::string &input_path, const std::string &m
 
 bool write_binary_image(const std::string &filename, int width, int height, int channels, const unsigned char *data) {
     spdlog::info("Writing binary image to: {}", filename);
+    PerfStage stage("encode", static_cast<int64_t>(width) * height, filename);
     std::string extension = std::filesystem::path(filename).extension().string();
     for (auto &c : extension) {
         c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
     }
 
     bool success = false;
-    if (extension == ".png") {
+    if (is_stdio_path(filename)) {
+        success = write_stdout_image(width, height, channels, data);
+    } else if (extension == ".png") {
         success = stbi_write_png(filename.c_str(), width, height, channels, data, width * channels);
     } else if (extension == ".jpg" || extension == ".jpeg") {
         success = stbi_write_jpg(filename.c_str(), width, height, channels, data, 90);
@@ -78,4 +204,199 @@ bool write_binary_image(const std::string &filename, int width, int height, int
         spdlog::error("Failed to write binary image: {}", filename);
     }
     return success;
-}
\ No newline at end of file
+}
+
+// Defined by stb_image_write (extern "C"), but only declared in its implementation section
+extern "C" unsigned char *stbi_zlib_compress(unsigned char *data, int data_len, int *out_len, int quality);
+
+// CRC-32 of a PNG chunk (type and data), table-driven
+static uint32_t png_crc32(const unsigned char *data, size_t length, uint32_t crc = 0xFFFFFFFFu) {
+    static const auto table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[n] = c;
+        }
+        return t;
+    }();
+    for (size_t i = 0; i < length; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+static void append_be32(std::vector<unsigned char> &out, uint32_t v) {
+    out.push_back(static_cast<unsigned char>(v >> 24));
+    out.push_back(static_cast<unsigned char>(v >> 16));
+    out.push_back(static_cast<unsigned char>(v >> 8));
+    out.push_back(static_cast<unsigned char>(v));
+}
+
+static void append_png_chunk(std::vector<unsigned char> &out, const char *type, const unsigned char *data, size_t length) {
+    append_be32(out, static_cast<uint32_t>(length));
+    const size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + length);
+    append_be32(out, png_crc32(out.data() + start, length + 4) ^ 0xFFFFFFFFu);
+}
+
+/**
+ * Writes a PNG with 16 bits per channel. stb_image_write only emits 8-bit
+ * PNGs, so the file is assembled here: big-endian samples, filter type 0 on
+ * every row and the zlib stream from stbi_zlib_compress.
+ */
+static bool write_png_16(std::ostream &out, int width, int height, int channels, const uint16_t *data) {
+    static const unsigned char colour_types[5] = {0, 0, 4, 2, 6}; // gray, gray+alpha, RGB, RGBA
+    const size_t row_bytes = static_cast<size_t>(width) * channels * 2 + 1;
+    std::vector<unsigned char> raw(row_bytes * height);
+
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < height; ++y) {
+        unsigned char *dst = raw.data() + y * row_bytes;
+        const uint16_t *src = data + static_cast<size_t>(y) * width * channels;
+        dst[0] = 0;
+        for (int i = 0; i < width * channels; ++i) {
+            dst[1 + 2 * i] = static_cast<unsigned char>(src[i] >> 8);
+            dst[2 + 2 * i] = static_cast<unsigned char>(src[i] & 0xFF);
+        }
+    }
+
+    int zlib_length = 0;
+    unsigned char *zlib = stbi_zlib_compress(raw.data(), static_cast<int>(raw.size()), &zlib_length, 8);
+    if (!zlib) return false;
+
+    std::vector<unsigned char> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    std::vector<unsigned char> header;
+    append_be32(header, static_cast<uint32_t>(width));
+    append_be32(header, static_cast<uint32_t>(height));
+    header.insert(header.end(), {16, colour_types[channels], 0, 0, 0});
+    append_png_chunk(png, "IHDR", header.data(), header.size());
+    append_png_chunk(png, "IDAT", zlib, static_cast<size_t>(zlib_length));
+    append_png_chunk(png, "IEND", nullptr, 0);
+    std::free(zlib);
+
+    out.write(reinterpret_cast<const char *>(png.data()), static_cast<std::streamsize>(png.size()));
+    return static_cast<bool>(out);
+}
+
+bool write_image_16(const std::string &filename, int width, int height, int channels, const uint16_t *data) {
+    spdlog::info("Writing 16-bit image to: {}", filename);
+    std::string extension = std::filesystem::path(filename).extension().string();
+    for (auto &c : extension) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+
+    // On stdout the format comes from --format instead of the extension
+    const bool to_stdout = is_stdio_path(filename);
+    const StreamFormat stream_format = g_stream_format.load();
+    const bool pnm = to_stdout ? stream_format == StreamFormat::Pnm : extension == ".pgm" || extension == ".ppm";
+    const bool png = to_stdout ? stream_format == StreamFormat::Png : extension == ".png" || extension.empty();
+
+    if (!pnm && !png) {
+        // No 16-bit variant of the format: keep the high byte
+        spdlog::warn("Format {} has no 16-bit support, writing 8 bits per channel",
+                     to_stdout ? stream_format_name(stream_format) : extension);
+        const size_t samples = static_cast<size_t>(width) * height * channels;
+        std::vector<unsigned char> narrow(samples);
+        for (size_t i = 0; i < samples; ++i) narrow[i] = static_cast<unsigned char>(data[i] >> 8);
+        return write_binary_image(filename, width, height, channels, narrow.data());
+    }
+
+    PerfStage stage("encode", static_cast<int64_t>(width) * height, filename);
+    std::ofstream ofs;
+    if (!to_stdout) {
+        ofs.open(filename, std::ios::binary);
+    }
+    std::ostream &out = to_stdout ? std::cout : ofs;
+    bool success = false;
+    if (out) {
+        success = pnm ? write_pnm(out, width, height, channels, data)
+                      : write_png_16(out, width, height, channels, data);
+    }
+    if (to_stdout) {
+        std::cout.flush();
+        success = success && static_cast<bool>(std::cout);
+    }
+
+    if (success) {
+        spdlog::info("Successfully wrote 16-bit image: {}", filename);
+    } else {
+        spdlog::error("Failed to write 16-bit image: {}", filename);
+    }
+    return success;
+}
+
+bool is_16bit_image(const std::string &path) {
+    if (is_stdio_path(path)) {
+        const std::vector<unsigned char> &bytes = stdin_bytes();
+        return stbi_is_16_bit_from_memory(bytes.data(), static_cast<int>(bytes.size())) != 0;
+    }
+    return stbi_is_16_bit(path.c_str()) != 0;
+}
+
+bool read_image_info(const std::string &path, int &width, int &height, int &channels) {
+    if (is_stdio_path(path)) {
+        const std::vector<unsigned char> &bytes = stdin_bytes();
+        return stbi_info_from_memory(bytes.data(), static_cast<int>(bytes.size()), &width, &height, &channels) != 0;
+    }
+    return stbi_info(path.c_str(), &width, &height, &channels) != 0;
+}
+
+template <typename Pixel>
+Pixel *load_image(const std::string &path, int &width, int &height, int &channels) {
+    PerfStage stage("decode", 0, path);
+    Pixel *image;
+    if (is_stdio_path(path)) {
+        // The stream is decoded from memory; stb_image detects the format from its signature
+        const std::vector<unsigned char> &bytes = stdin_bytes();
+        const int length = static_cast<int>(bytes.size());
+        if constexpr (sizeof(Pixel) == 2) {
+            image = stbi_load_16_from_memory(bytes.data(), length, &width, &height, &channels, 0);
+        } else {
+            image = stbi_load_from_memory(bytes.data(), length, &width, &height, &channels, 0);
+        }
+    } else if constexpr (sizeof(Pixel) == 2) {
+        image = stbi_load_16(path.c_str(), &width, &height, &channels, 0);
+    } else {
+        image = stbi_load(path.c_str(), &width, &height, &channels, 0);
+    }
+    if (image) {
+        stage.set_pixels(static_cast<int64_t>(width) * height);
+    }
+    return image;
+}
+
+template uint8_t *load_image<uint8_t>(const std::string &, int &, int &, int &);
+template uint16_t *load_image<uint16_t>(const std::string &, int &, int &, int &);
+
+/**
+ * Converts an interleaved image to grayscale with the luminance weights used
+ * throughout the tool. Images with fewer than three channels (gray, gray +
+ * alpha) take their first channel unchanged.
+ *
+ * @param image Interleaved input image.
+ * @param channels Number of channels of the input image.
+ * @param gray Output grayscale plane.
+ * @param pixels Number of pixels.
+ */
+template <typename Pixel>
+void convert_to_grayscale(const Pixel *image, int channels, Pixel *gray, size_t pixels) {
+    const int64_t n = static_cast<int64_t>(pixels);
+    if (channels < 3) {
+        #pragma omp parallel for simd
+        for (int64_t i = 0; i < n; i++) {
+            gray[i] = image[i * channels];
+        }
+        return;
+    }
+
+    #pragma omp parallel for simd
+    for (int64_t i = 0; i < n; i++) {
+        gray[i] = static_cast<Pixel>(
+                0.2126f * image[i * channels + 0] +
+                0.7152f * image[i * channels + 1] +
+                0.0722f * image[i * channels + 2]);
+    }
+}
+
+template void convert_to_grayscale<uint8_t>(const uint8_t *, int, uint8_t *, size_t);
+template void convert_to_grayscale<uint16_t>(const uint16_t *, int, uint16_t *, size_t);
@@ -0,0 +1,259 @@
+#include <utils/numa.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <omp.h>
+#include <spdlog/spdlog.h>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::atomic<ThreadBinding> g_binding{ThreadBinding::None};
+
+// Pages sampled by page_nodes; enough for a percentage, cheap for any image size
+constexpr size_t PAGE_SAMPLES = 4096;
+
+#if defined(__linux__)
+
+struct CpuInfo {
+    int cpu;
+    int socket;
+    int core;
+    int sibling;  // 0 for the first hardware thread of a core, 1 for its SMT sibling, ...
+};
+
+int read_topology(int cpu, const char *name) {
+    std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + name);
+    int value = 0;
+    if (!(file >> value)) return 0;
+    return value;
+}
+
+int socket_of(int cpu) {
+    return cpu < 0 ? 0 : read_topology(cpu, "physical_package_id");
+}
+
+// CPUs this process may run on, with socket, core and SMT rank
+std::vector<CpuInfo> allowed_cpus() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    std::vector<CpuInfo> cpus;
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return cpus;
+
+    std::map<std::pair<int, int>, int> seen;  // (socket, core) -> hardware threads so far
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &set)) continue;
+        const int socket = socket_of(cpu);
+        const int core = read_topology(cpu, "core_id");
+        cpus.push_back({cpu, socket, core, seen[{socket, core}]++});
+    }
+    return cpus;
+}
+
+int numa_node_count() {
+    int nodes = 0;
+    while (std::ifstream("/sys/devices/system/node/node" + std::to_string(nodes) + "/cpumap")) ++nodes;
+    return nodes;
+}
+
+#endif
+
+} // namespace
+
+/**
+ * Zeroes a buffer in parallel. Each thread clears one contiguous share, in
+ * thread order, like the schedule(static) loops of the kernels, so with a
+ * fixed thread count the pages end up on the node of the thread that
+ * processes them later.
+ *
+ * @param data Start of the buffer (pages not touched yet).
+ * @param bytes Buffer size.
+ */
+void first_touch(void *data, size_t bytes) {
+    unsigned char *bytes_ptr = static_cast<unsigned char *>(data);
+    #pragma omp parallel
+    {
+        const size_t threads = static_cast<size_t>(omp_get_num_threads());
+        const size_t t = static_cast<size_t>(omp_get_thread_num());
+        const size_t begin = bytes * t / threads;
+        const size_t end = bytes * (t + 1) / threads;
+        std::memset(bytes_ptr + begin, 0, end - begin);
+    }
+}
+
+bool parse_thread_binding(const std::string &name, ThreadBinding &binding) {
+    if (name == "none") binding = ThreadBinding::None;
+    else if (name == "close") binding = ThreadBinding::Close;
+    else if (name == "spread") binding = ThreadBinding::Spread;
+    else return false;
+    return true;
+}
+
+const char *thread_binding_name(ThreadBinding binding) {
+    switch (binding) {
+        case ThreadBinding::Close: return "close";
+        case ThreadBinding::Spread: return "spread";
+        default: return "none";
+    }
+}
+
+ThreadBinding current_thread_binding() {
+    return g_binding.load();
+}
+
+/**
+ * Pins every thread of the OpenMP pool to one CPU. Physical cores come first,
+ * SMT siblings only when there are more threads than cores. "close" fills
+ * socket 0 before socket 1, "spread" alternates between sockets, so two
+ * threads already use the memory bandwidth of both. Later parallel regions with
+ * the same or fewer threads keep their pool threads and therefore the pinning.
+ *
+ * @param binding Placement policy; None leaves placement to the OpenMP runtime.
+ * @return false if the topology could not be read or a thread could not be pinned.
+ */
+bool bind_threads(ThreadBinding binding) {
+    if (binding == ThreadBinding::None) return true;
+#if defined(__linux__)
+    std::vector<CpuInfo> cpus = allowed_cpus();
+    if (cpus.empty()) {
+        spdlog::warn("Thread binding: CPU affinity unavailable, continuing unpinned");
+        return false;
+    }
+
+    // Rank of each CPU within its socket among CPUs of the same SMT rank
+    std::map<std::pair<int, int>, int> rank_in_socket;
+    std::vector<int> socket_rank(cpus.size());
+    for (size_t i = 0; i < cpus.size(); ++i) {
+        socket_rank[i] = rank_in_socket[{cpus[i].sibling, cpus[i].socket}]++;
+    }
+    std::vector<size_t> order(cpus.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        const CpuInfo &x = cpus[a], &y = cpus[b];
+        if (x.sibling != y.sibling) return x.sibling < y.sibling;
+        if (binding == ThreadBinding::Spread && socket_rank[a] != socket_rank[b]) return socket_rank[a] < socket_rank[b];
+        if (x.socket != y.socket) return x.socket < y.socket;
+        return x.core < y.core;
+    });
+
+    std::atomic<int> failures{0};
+    #pragma omp parallel
+    {
+        const CpuInfo &cpu = cpus[order[omp_get_thread_num() % order.size()]];
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu.cpu, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) failures++;
+    }
+    if (failures > 0) {
+        spdlog::warn("Thread binding: {} thread(s) could not be pinned", failures.load());
+        return false;
+    }
+    g_binding.store(binding);
+    spdlog::info("Thread binding {}: {} thread(s) on {} allowed CPU(s)", thread_binding_name(binding),
+                 omp_get_max_threads(), cpus.size());
+    return true;
+#else
+    spdlog::warn("Thread binding is only supported on Linux, continuing unpinned");
+    return false;
+#endif
+}
+
+/**
+ * Runs one parallel region and records on which CPU and socket every pool
+ * thread currently runs. Unpinned threads may migrate afterwards.
+ *
+ * @return One entry per socket in use, in socket order.
+ */
+std::vector<SocketPlacement> thread_placement() {
+    const int threads = omp_get_max_threads();
+    std::vector<int> cpu_of_thread(threads, -1);
+    #pragma omp parallel num_threads(threads)
+    {
+#if defined(__linux__)
+        cpu_of_thread[omp_get_thread_num()] = sched_getcpu();
+#endif
+    }
+
+    std::map<int, SocketPlacement> sockets;
+    for (int cpu : cpu_of_thread) {
+#if defined(__linux__)
+        const int socket = socket_of(cpu);
+#else
+        const int socket = 0;
+#endif
+        SocketPlacement &placement = sockets.try_emplace(socket, SocketPlacement{socket, 0, {}}).first->second;
+        placement.threads++;
+        placement.cpus.push_back(cpu);
+    }
+    std::vector<SocketPlacement> result;
+    for (auto &[socket, placement] : sockets) result.push_back(std::move(placement));
+    return result;
+}
+
+void log_thread_placement() {
+    for (const SocketPlacement &placement : thread_placement()) {
+        std::string cpus;
+        for (int cpu : placement.cpus) cpus += (cpus.empty() ? "" : ",") + std::to_string(cpu);
+        spdlog::info("Socket {}: {} thread(s) on CPU(s) {}", placement.socket, placement.threads, cpus);
+    }
+}
+
+/**
+ * Queries the NUMA node of up to PAGE_SAMPLES evenly spaced pages of a buffer
+ * with move_pages (query mode, nothing is moved).
+ *
+ * @return Sampled pages per node; pages not touched yet are not counted.
+ */
+std::vector<int64_t> page_nodes(const void *data, size_t bytes) {
+    std::vector<int64_t> counts;
+#if defined(__linux__) && defined(SYS_move_pages)
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t first = reinterpret_cast<uintptr_t>(data) / page * page;
+    const size_t pages = (reinterpret_cast<uintptr_t>(data) + bytes - first + page - 1) / page;
+    if (bytes == 0 || pages == 0) return counts;
+
+    const size_t samples = std::min(pages, PAGE_SAMPLES);
+    std::vector<void *> addresses(samples);
+    std::vector<int> status(samples, -1);
+    for (size_t i = 0; i < samples; ++i) {
+        addresses[i] = reinterpret_cast<void *>(first + (pages * i / samples) * page);
+    }
+    if (syscall(SYS_move_pages, 0, samples, addresses.data(), nullptr, status.data(), 0) != 0) return counts;
+
+    for (int node : status) {
+        if (node < 0) continue;
+        if (static_cast<size_t>(node) >= counts.size()) counts.resize(node + 1, 0);
+        counts[node]++;
+    }
+#else
+    (void)data;
+    (void)bytes;
+#endif
+    return counts;
+}
+
+void log_page_placement(const char *name, const void *data, size_t bytes) {
+#if defined(__linux__)
+    static const int nodes = numa_node_count();
+    if (nodes < 2) return;
+#endif
+    const std::vector<int64_t> counts = page_nodes(data, bytes);
+    int64_t total = 0;
+    for (int64_t c : counts) total += c;
+    if (total == 0) return;
+
+    std::string shares;
+    for (size_t node = 0; node < counts.size(); ++node) {
+        shares += fmt::format("{}node {}: {:.1f}%", shares.empty() ? "" : ", ", node, 100.0 * counts[node] / total);
+    }
+    spdlog::info("Pages of {} ({} MB): {}", name, bytes >> 20, shares);
+}
@@ -0,0 +1,24 @@
+#include <utils/perf_report.h>
+#include <cstdlib>
+#include <new>
+
+// Global allocation functions, replaced so that the performance report can count
+// the bytes requested per stage. Kept apart from the report so that its own
+// containers do not see the replacement inlined against free().
+
+void *operator new(size_t size) {
+    if (void *p = perf_malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(size_t size, std::align_val_t align) {
+    const size_t alignment = static_cast<size_t>(align);
+    const size_t rounded = (size + alignment - 1) / alignment * alignment;
+    if (void *p = perf_aligned_malloc(alignment, rounded ? rounded : alignment)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { perf_free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { perf_free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { perf_free(ptr); }
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept { perf_free(ptr); }
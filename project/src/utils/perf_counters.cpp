@@ -0,0 +1,185 @@
+#include <utils/perf_counters.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <omp.h>
+#include <spdlog/spdlog.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr int EVENT_COUNT = 4;
+constexpr double CACHE_LINE_BYTES = 64.0;
+
+// One counter group per thread; the cycles counter leads, events the CPU does not
+// support are left out of the group (fd -1)
+struct ThreadCounters {
+    int fds[EVENT_COUNT] = {-1, -1, -1, -1};
+    int slot[EVENT_COUNT] = {-1, -1, -1, -1};  // position of the event in the group read
+    int members = 0;
+};
+
+std::vector<ThreadCounters> g_threads;
+std::atomic<bool> g_enabled{false};
+
+#if defined(__linux__)
+
+const uint64_t EVENT_CONFIG[EVENT_COUNT] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,    // last-level cache on current Intel and AMD cores
+    PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+int open_event(uint64_t config, int group_fd) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = group_fd == -1 ? 1 : 0;
+    attr.exclude_kernel = 1;  // allowed with the default perf_event_paranoid = 2
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+// Opens the group on the calling thread; errno of the leader on failure
+int open_thread_counters(ThreadCounters &counters) {
+    counters.fds[0] = open_event(EVENT_CONFIG[0], -1);
+    if (counters.fds[0] < 0) return errno;
+    counters.slot[0] = counters.members++;
+
+    for (int e = 1; e < EVENT_COUNT; ++e) {
+        counters.fds[e] = open_event(EVENT_CONFIG[e], counters.fds[0]);
+        if (counters.fds[e] >= 0) counters.slot[e] = counters.members++;
+    }
+    ioctl(counters.fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(counters.fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return 0;
+}
+
+void close_all() {
+    for (ThreadCounters &counters : g_threads) {
+        for (int &fd : counters.fds) {
+            if (fd >= 0) close(fd);
+            fd = -1;
+        }
+    }
+    g_threads.clear();
+}
+
+#endif
+
+} // namespace
+
+/**
+ * Opens one counter group on every thread of the OpenMP pool. Counters opened
+ * with pid 0 follow only their own thread, so each pool thread opens its group
+ * inside a parallel region; the groups stay open and any thread may read them.
+ *
+ * @return false if the counters are not available; processing continues without them.
+ */
+bool perf_counters_enable() {
+#if defined(__linux__)
+    if (g_enabled.load()) return true;
+
+    const int threads = omp_get_max_threads();
+    g_threads.assign(threads, ThreadCounters());
+    std::vector<int> errors(threads, 0);
+
+    #pragma omp parallel num_threads(threads)
+    {
+        const int t = omp_get_thread_num();
+        errors[t] = open_thread_counters(g_threads[t]);
+    }
+
+    for (int t = 0; t < threads; ++t) {
+        if (errors[t] != 0) {
+            spdlog::warn("Hardware counters unavailable ({}); check /proc/sys/kernel/perf_event_paranoid. "
+                         "Continuing without counters.", std::strerror(errors[t]));
+            close_all();
+            return false;
+        }
+    }
+
+    const ThreadCounters &first = g_threads.front();
+    spdlog::info("Hardware counters enabled on {} thread(s): cycles, instructions{}{}", threads,
+                 first.fds[2] >= 0 ? ", LLC misses" : "", first.fds[3] >= 0 ? ", branch misses" : "");
+    g_enabled.store(true);
+    return true;
+#else
+    spdlog::warn("Hardware counters are only supported on Linux; continuing without counters.");
+    return false;
+#endif
+}
+
+bool perf_counters_enabled() {
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+CounterSample perf_counters_read() {
+    CounterSample sample;
+#if defined(__linux__)
+    if (!perf_counters_enabled()) return sample;
+
+    double totals[EVENT_COUNT] = {0.0, 0.0, 0.0, 0.0};
+    bool available[EVENT_COUNT] = {true, true, true, true};
+
+    for (const ThreadCounters &counters : g_threads) {
+        // Layout: nr, time_enabled, time_running, value[nr]
+        uint64_t buffer[3 + EVENT_COUNT];
+        const ssize_t expected = static_cast<ssize_t>((3 + counters.members) * sizeof(uint64_t));
+        if (read(counters.fds[0], buffer, sizeof(buffer)) != expected) return sample;
+
+        // Scale up if the group was multiplexed with other users of the PMU
+        const double scale = buffer[2] > 0 ? static_cast<double>(buffer[1]) / buffer[2] : 0.0;
+        for (int e = 0; e < EVENT_COUNT; ++e) {
+            if (counters.slot[e] < 0) {
+                available[e] = false;
+                continue;
+            }
+            totals[e] += static_cast<double>(buffer[3 + counters.slot[e]]) * scale;
+        }
+    }
+
+    sample.cycles = static_cast<int64_t>(totals[0]);
+    sample.instructions = available[1] ? static_cast<int64_t>(totals[1]) : -1;
+    sample.llc_misses = available[2] ? static_cast<int64_t>(totals[2]) : -1;
+    sample.branch_misses = available[3] ? static_cast<int64_t>(totals[3]) : -1;
+#endif
+    return sample;
+}
+
+CounterSample counter_delta(const CounterSample &begin, const CounterSample &end) {
+    auto diff = [](int64_t a, int64_t b) { return (a < 0 || b < 0) ? -1 : std::max<int64_t>(0, b - a); };
+    CounterSample delta;
+    delta.cycles = diff(begin.cycles, end.cycles);
+    delta.instructions = diff(begin.instructions, end.instructions);
+    delta.llc_misses = diff(begin.llc_misses, end.llc_misses);
+    delta.branch_misses = diff(begin.branch_misses, end.branch_misses);
+    return delta;
+}
+
+double counter_ipc(const CounterSample &delta) {
+    if (delta.cycles <= 0 || delta.instructions < 0) return -1.0;
+    return static_cast<double>(delta.instructions) / delta.cycles;
+}
+
+double counter_per_pixel(int64_t count, int64_t pixels) {
+    if (count < 0 || pixels <= 0) return -1.0;
+    return static_cast<double>(count) / pixels;
+}
+
+double counter_bytes_per_pixel(const CounterSample &delta, int64_t pixels) {
+    const double misses = counter_per_pixel(delta.llc_misses, pixels);
+    return misses < 0.0 ? -1.0 : misses * CACHE_LINE_BYTES;
+}
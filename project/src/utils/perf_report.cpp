@@ -0,0 +1,341 @@
+#include <utils/perf_report.h>
+#include <utils/trace.h>
+#include <utils/numa.h>
+#include <utils/plane_arena.h>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <vector>
+#include <omp.h>
+#include <spdlog/spdlog.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+struct StageRecord {
+    std::string stage;
+    std::string detail;
+    double seconds;
+    int64_t pixels;
+    int threads;
+    uint64_t bytes_allocated;
+    int64_t peak_rss_bytes;
+    CounterSample counters;
+    bool attributable;  // false: bytes_allocated and counters include overlapping stages
+};
+
+struct JobRecord {
+    std::string name;
+    double seconds = 0.0;
+    std::vector<StageRecord> stages;
+};
+
+struct Report {
+    std::mutex mutex;
+    bool enabled = false;
+    std::string input_path;
+    std::string method;
+    Clock::time_point start;
+    std::vector<JobRecord> jobs;
+    std::vector<TaskGraphNodeRecord> task_nodes;
+    double critical_path_seconds = -1.0;  // < 0: no task graph ran
+    double task_graph_wall_seconds = 0.0;
+};
+
+Report &report() {
+    static Report instance;
+    return instance;
+}
+
+// Counts every heap request; relaxed because only the totals matter
+std::atomic<uint64_t> g_allocated_bytes{0};
+
+// Stages of different jobs run at the same time (task graph)
+std::atomic<bool> g_overlapping{false};
+
+// Job the stages of this thread belong to (-1: none yet)
+thread_local int t_current_job = -1;
+
+// Index of the implicit job for stages outside any PerfJob; caller holds the mutex
+int implicit_job(Report &r) {
+    for (size_t i = 0; i < r.jobs.size(); ++i) {
+        if (r.jobs[i].name == "main") return static_cast<int>(i);
+    }
+    r.jobs.push_back({"main", 0.0, {}});
+    return static_cast<int>(r.jobs.size() - 1);
+}
+
+std::string json_escape(const std::string &value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        switch (c) {
+            case '"': escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\t': escaped += "\\t"; break;
+            default: escaped += c;
+        }
+    }
+    return escaped;
+}
+
+double mpix_per_second(int64_t pixels, double seconds) {
+    return seconds > 0.0 ? static_cast<double>(pixels) / 1e6 / seconds : 0.0;
+}
+
+// Unavailable counters (< 0) are written as null
+template <typename T>
+void write_counter(std::ostream &json, const char *key, T value) {
+    json << ", \"" << key << "\": ";
+    if (value < 0) json << "null";
+    else json << value;
+}
+
+void write_counters(std::ostream &json, const CounterSample &c, int64_t pixels) {
+    write_counter(json, "cycles", c.cycles);
+    write_counter(json, "instructions", c.instructions);
+    write_counter(json, "ipc", counter_ipc(c));
+    write_counter(json, "llc_misses", c.llc_misses);
+    write_counter(json, "llc_misses_per_pixel", counter_per_pixel(c.llc_misses, pixels));
+    write_counter(json, "est_bytes_per_pixel", counter_bytes_per_pixel(c, pixels));
+    write_counter(json, "branch_misses", c.branch_misses);
+    write_counter(json, "branch_misses_per_pixel", counter_per_pixel(c.branch_misses, pixels));
+}
+
+// One log line per stage with the derived counter metrics
+void log_counters(const char *stage, const CounterSample &c, int64_t pixels) {
+    if (pixels > 0) {
+        spdlog::info("Counters {}: IPC {:.2f}, LLC misses/px {:.4f} (~{:.2f} B/px), branch misses/px {:.4f}",
+                     stage, counter_ipc(c), counter_per_pixel(c.llc_misses, pixels),
+                     counter_bytes_per_pixel(c, pixels), counter_per_pixel(c.branch_misses, pixels));
+    } else {
+        spdlog::info("Counters {}: IPC {:.2f}, {} cycles, {} LLC misses, {} branch misses",
+                     stage, counter_ipc(c), c.cycles, c.llc_misses, c.branch_misses);
+    }
+}
+
+} // namespace
+
+uint64_t allocated_bytes() {
+    return g_allocated_bytes.load(std::memory_order_relaxed);
+}
+
+/**
+ * Peak resident set size of the process. Linux reports ru_maxrss in kilobytes,
+ * macOS in bytes; other systems report 0.
+ */
+int64_t peak_rss_bytes() {
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage {};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+    return static_cast<int64_t>(usage.ru_maxrss);
+#else
+    return static_cast<int64_t>(usage.ru_maxrss) * 1024;
+#endif
+#else
+    return 0;
+#endif
+}
+
+void *perf_malloc(size_t size) {
+    g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    return std::malloc(size);
+}
+
+void *perf_aligned_malloc(size_t alignment, size_t size) {
+    g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    return std::aligned_alloc(alignment, size);
+}
+
+void *perf_realloc(void *ptr, size_t size) {
+    g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    return std::realloc(ptr, size);
+}
+
+void perf_free(void *ptr) {
+    std::free(ptr);
+}
+
+void perf_count_allocation(size_t size) {
+    g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void perf_report_enable(const std::string &input_path, const std::string &method) {
+    Report &r = report();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.enabled = true;
+    r.input_path = input_path;
+    r.method = method;
+    r.start = Clock::now();
+    r.jobs.clear();
+    r.task_nodes.clear();
+    r.critical_path_seconds = -1.0;
+}
+
+void perf_report_task_graph(const std::vector<TaskGraphNodeRecord> &nodes, double critical_path_seconds,
+                            double wall_seconds) {
+    Report &r = report();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (!r.enabled) return;
+    r.task_nodes = nodes;
+    r.critical_path_seconds = critical_path_seconds;
+    r.task_graph_wall_seconds = wall_seconds;
+}
+
+void perf_report_set_overlapping(bool overlapping) {
+    g_overlapping.store(overlapping);
+    if (overlapping && (perf_counters_enabled() || perf_report_enabled())) {
+        spdlog::info("Stages overlap: per-stage allocations and hardware counters are not attributable and reported as null");
+    }
+}
+
+bool perf_report_enabled() {
+    Report &r = report();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    return r.enabled;
+}
+
+PerfJob::PerfJob(const std::string &name)
+    : index_(-1), previous_(t_current_job),
+      trace_name_(trace_enabled() ? trace_detail::intern(name) : nullptr),
+      trace_begin_(trace_name_ ? trace_detail::now_ns() : -1), start_(Clock::now()) {
+    Report &r = report();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (!r.enabled) return;
+    r.jobs.push_back({name, 0.0, {}});
+    index_ = static_cast<int>(r.jobs.size() - 1);
+    t_current_job = index_;
+}
+
+PerfJob::~PerfJob() {
+    const double seconds = std::chrono::duration<double>(Clock::now() - start_).count();
+    if (trace_begin_ >= 0) trace_detail::record(trace_name_, "job", trace_begin_, trace_detail::now_ns());
+    t_current_job = previous_;
+    if (index_ < 0) return;
+    Report &r = report();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.jobs[index_].seconds = seconds;
+}
+
+PerfStage::PerfStage(const char *stage, int64_t pixels, std::string detail)
+    : stage_(stage), detail_(std::move(detail)), pixels_(pixels), threads_(omp_get_max_threads()),
+      allocated_start_(allocated_bytes()), attributable_(!g_overlapping.load()), trace_begin_(trace_enabled() ? trace_detail::now_ns() : -1),
+      counters_start_(perf_counters_read()), start_(Clock::now()) {}
+
+PerfStage::~PerfStage() {
+    stop();
+}
+
+double PerfStage::stop() {
+    if (seconds_ >= 0.0) return seconds_;
+    seconds_ = std::chrono::duration<double>(Clock::now() - start_).count();
+    // Allocations and counters are process-wide; while other stages overlap they are not this stage's
+    attributable_ = attributable_ && !g_overlapping.load();
+    const CounterSample counters = attributable_ ? counter_delta(counters_start_, perf_counters_read()) : CounterSample{};
+    if (trace_begin_ >= 0) trace_detail::record(stage_, "stage", trace_begin_, trace_detail::now_ns());
+    if (counters.valid()) log_counters(stage_, counters, pixels_);
+
+    Report &r = report();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (!r.enabled) return seconds_;
+    const int job = t_current_job >= 0 ? t_current_job : implicit_job(r);
+    r.jobs[job].stages.push_back({stage_, detail_, seconds_, pixels_, threads_,
+                                  allocated_bytes() - allocated_start_, peak_rss_bytes(), counters, attributable_});
+    return seconds_;
+}
+
+/**
+ * Writes the report: run metadata, then every job with its stages in the
+ * order they finished.
+ *
+ * @param path Output JSON file.
+ * @return false if the file could not be written.
+ */
+bool perf_report_write(const std::string &path) {
+    Report &r = report();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    std::ofstream json(path);
+    if (!json) {
+        spdlog::error("Failed to write performance report: {}", path);
+        return false;
+    }
+
+    const double wall_seconds = std::chrono::duration<double>(Clock::now() - r.start).count();
+    json << "{\n"
+         << "  \"input\": \"" << json_escape(r.input_path) << "\",\n"
+         << "  \"method\": \"" << json_escape(r.method) << "\",\n"
+         << "  \"threads\": " << omp_get_max_threads() << ",\n"
+         << "  \"wall_seconds\": " << wall_seconds << ",\n"
+         << "  \"peak_rss_bytes\": " << peak_rss_bytes() << ",\n"
+         << "  \"bytes_allocated\": " << allocated_bytes() << ",\n"
+         << "  \"hardware_counters\": " << (perf_counters_enabled() ? "true" : "false") << ",\n"
+         << "  \"binding\": \"" << thread_binding_name(current_thread_binding()) << "\",\n"
+         << "  \"sockets\": [";
+    const std::vector<SocketPlacement> sockets = thread_placement();
+    for (size_t i = 0; i < sockets.size(); ++i) {
+        json << (i ? ", " : "") << "{\"socket\": " << sockets[i].socket << ", \"threads\": " << sockets[i].threads
+             << ", \"cpus\": [";
+        for (size_t c = 0; c < sockets[i].cpus.size(); ++c) json << (c ? ", " : "") << sockets[i].cpus[c];
+        json << "]}";
+    }
+    const PlaneArenaStats arena = plane_arena_stats();
+    json << "],\n"
+         << "  \"plane_arena\": {\"huge_pages\": \"" << huge_pages_name(current_huge_pages())
+         << "\", \"allocations\": " << arena.allocations << ", \"reuses\": " << arena.reuses
+         << ", \"reserved_bytes\": " << arena.reserved_bytes << ", \"huge_page_bytes\": " << arena.huge_page_bytes << "},\n";
+    if (r.critical_path_seconds >= 0.0) {
+        json << "  \"task_graph\": {\"wall_seconds\": " << r.task_graph_wall_seconds
+             << ", \"critical_path_seconds\": " << r.critical_path_seconds << ", \"critical_path\": [";
+        bool first = true;
+        for (const TaskGraphNodeRecord &node : r.task_nodes) {
+            if (!node.critical) continue;
+            json << (first ? "" : ", ") << "\"" << json_escape(node.name) << "\"";
+            first = false;
+        }
+        json << "], \"nodes\": [";
+        for (size_t i = 0; i < r.task_nodes.size(); ++i) {
+            const TaskGraphNodeRecord &node = r.task_nodes[i];
+            json << (i ? ", " : "") << "{\"name\": \"" << json_escape(node.name) << "\", \"start\": " << node.start_seconds
+                 << ", \"end\": " << node.end_seconds << ", \"threads\": " << node.threads << "}";
+        }
+        json << "]},\n";
+    }
+    json << "  \"jobs\": [\n";
+
+    for (size_t j = 0; j < r.jobs.size(); ++j) {
+        const JobRecord &job = r.jobs[j];
+        json << "    {\n"
+             << "      \"name\": \"" << json_escape(job.name) << "\",\n"
+             << "      \"seconds\": " << job.seconds << ",\n"
+             << "      \"stages\": [\n";
+        for (size_t s = 0; s < job.stages.size(); ++s) {
+            const StageRecord &st = job.stages[s];
+            json << "        {\"stage\": \"" << st.stage << "\", \"detail\": \"" << json_escape(st.detail)
+                 << "\", \"seconds\": " << st.seconds << ", \"pixels\": " << st.pixels
+                 << ", \"mpix_per_second\": " << mpix_per_second(st.pixels, st.seconds)
+                 << ", \"threads\": " << st.threads << ", \"bytes_allocated\": ";
+            if (st.attributable) json << st.bytes_allocated;
+            else json << "null";
+            json << ", \"peak_rss_bytes\": " << st.peak_rss_bytes;
+            // Unattributable stages keep the counter keys, all null
+            if (st.counters.valid() || (!st.attributable && perf_counters_enabled())) {
+                write_counters(json, st.counters, st.pixels);
+            }
+            json << "}" << (s + 1 < job.stages.size() ? "," : "") << "\n";
+        }
+        json << "      ]\n    }" << (j + 1 < r.jobs.size() ? "," : "") << "\n";
+    }
+    json << "  ]\n}\n";
+
+    spdlog::info("Performance report written to: {}", path);
+    return static_cast<bool>(json);
+}
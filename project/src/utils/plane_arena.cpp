@@ -0,0 +1,313 @@
+#include <utils/plane_arena.h>
+#include <utils/numa.h>
+#include <utils/perf_report.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <set>
+#include <vector>
+#include <spdlog/spdlog.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+constexpr size_t ALIGNMENT = 64;
+// Requests below this size are served by the heap and never cached
+constexpr size_t MIN_ARENA_BYTES = size_t(256) << 10;
+// Arena blocks are rounded to this granule, so planes of similar size share blocks
+constexpr size_t ARENA_GRANULE = size_t(64) << 10;
+constexpr size_t HUGE_PAGE_BYTES = size_t(2) << 20;
+// Free blocks kept per arena; the oldest are released when a further one comes back
+constexpr size_t MAX_FREE_BLOCKS = 16;
+// Bytes kept in free blocks per arena, as a multiple of its largest live (or just released) block
+constexpr size_t MAX_FREE_PLANES = 4;
+
+struct PlaneArena;
+
+// Precedes every block; the data starts right after it and keeps its 64-byte alignment
+struct alignas(ALIGNMENT) BlockHeader {
+    PlaneArena *owner;  // nullptr for small heap blocks
+    size_t capacity;    // usable bytes after the header
+    size_t size;        // bytes last requested (copied by plane_arena_realloc)
+    size_t mapped;      // length of a MAP_HUGETLB mapping, 0 for heap memory
+    bool huge;          // backed by explicit or transparent huge pages
+};
+static_assert(sizeof(BlockHeader) == ALIGNMENT, "block data must stay 64-byte aligned");
+
+struct PlaneArena {
+    std::mutex mutex;
+    std::vector<BlockHeader *> free_blocks;  // oldest first
+    size_t free_bytes = 0;                   // capacity of the free blocks
+    std::multiset<size_t> live;              // capacity of every handed-out block
+    bool orphaned = false;                   // owning thread has exited
+};
+
+std::atomic<HugePages> g_huge_pages{HugePages::Off};
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_reuses{0};
+std::atomic<uint64_t> g_reserved_bytes{0};
+std::atomic<uint64_t> g_huge_page_bytes{0};
+
+void destroy_block(BlockHeader *header);
+
+// Owns the arena of a thread. On thread exit the cached blocks are released; planes still
+// in use may come back later from other threads, so the arena itself goes with the last one.
+struct ArenaOwner {
+    PlaneArena *arena = nullptr;
+
+    ~ArenaOwner() {
+        if (!arena) return;
+        std::vector<BlockHeader *> blocks;
+        bool unused;
+        {
+            std::lock_guard<std::mutex> lock(arena->mutex);
+            arena->orphaned = true;
+            blocks.swap(arena->free_blocks);
+            arena->free_bytes = 0;
+            unused = arena->live.empty();
+        }
+        for (BlockHeader *block : blocks) destroy_block(block);
+        if (unused) delete arena;
+    }
+};
+
+thread_local ArenaOwner t_owner;
+
+PlaneArena *current_arena() {
+    if (!t_owner.arena) t_owner.arena = new PlaneArena;
+    return t_owner.arena;
+}
+
+size_t round_up(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+BlockHeader *header_of(const void *ptr) {
+    return reinterpret_cast<BlockHeader *>(const_cast<unsigned char *>(static_cast<const unsigned char *>(ptr))) - 1;
+}
+
+void *data_of(BlockHeader *header) {
+    return header + 1;
+}
+
+/**
+ * Reserves a block for at least `bytes` bytes. Arena blocks of 2 MB and more
+ * use huge pages if enabled: explicit mode maps them from the hugetlbfs pool
+ * and falls back to transparent huge pages when the pool is empty.
+ *
+ * @param owner Arena the block returns to, nullptr for a plain heap block.
+ * @return Header of the new block, nullptr if out of memory.
+ */
+BlockHeader *new_block(size_t bytes, PlaneArena *owner) {
+    const HugePages mode = owner ? g_huge_pages.load(std::memory_order_relaxed) : HugePages::Off;
+    void *base = nullptr;
+    size_t total = 0, mapped = 0;
+    bool huge = false;
+
+    if (mode != HugePages::Off && bytes + sizeof(BlockHeader) >= HUGE_PAGE_BYTES) {
+        total = round_up(bytes + sizeof(BlockHeader), HUGE_PAGE_BYTES);
+#if defined(__linux__) && defined(MAP_HUGETLB)
+        if (mode == HugePages::Explicit) {
+            void *p = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED) {
+                base = p;
+                mapped = total;
+                huge = true;
+                perf_count_allocation(total);
+            } else {
+                static std::atomic<bool> warned{false};
+                if (!warned.exchange(true)) {
+                    spdlog::warn("Plane arena: no explicit huge pages available (vm.nr_hugepages), using transparent huge pages");
+                }
+            }
+        }
+#endif
+        if (!base) {
+            base = perf_aligned_malloc(HUGE_PAGE_BYTES, total);
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+            huge = base && madvise(base, total, MADV_HUGEPAGE) == 0;
+#endif
+        }
+    } else {
+        total = round_up(bytes + sizeof(BlockHeader), owner ? ARENA_GRANULE : ALIGNMENT);
+        base = perf_aligned_malloc(ALIGNMENT, total);
+    }
+    if (!base) return nullptr;
+
+    BlockHeader *header = new (base) BlockHeader{owner, total - sizeof(BlockHeader), bytes, mapped, huge};
+    if (owner) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        g_reserved_bytes.fetch_add(total, std::memory_order_relaxed);
+        if (huge) g_huge_page_bytes.fetch_add(total, std::memory_order_relaxed);
+        // Fresh pages go to the nodes of the threads that process them; reused blocks keep their placement
+        first_touch(data_of(header), header->capacity);
+    }
+    return header;
+}
+
+void destroy_block(BlockHeader *header) {
+    const size_t total = header->capacity + sizeof(BlockHeader);
+    if (header->owner) {
+        g_reserved_bytes.fetch_sub(total, std::memory_order_relaxed);
+        if (header->huge) g_huge_page_bytes.fetch_sub(total, std::memory_order_relaxed);
+    }
+#if defined(__linux__)
+    if (header->mapped) {
+        munmap(header, header->mapped);
+        return;
+    }
+#endif
+    perf_free(header);
+}
+
+// Smallest cached block that holds `bytes` without wasting more than half of it
+BlockHeader *take_block(PlaneArena &arena, size_t bytes) {
+    std::lock_guard<std::mutex> lock(arena.mutex);
+    auto best = arena.free_blocks.end();
+    for (auto it = arena.free_blocks.begin(); it != arena.free_blocks.end(); ++it) {
+        const size_t capacity = (*it)->capacity;
+        if (capacity < bytes || capacity / 2 > bytes) continue;
+        if (best == arena.free_blocks.end() || capacity < (*best)->capacity) best = it;
+    }
+    if (best == arena.free_blocks.end()) return nullptr;
+    BlockHeader *header = *best;
+    arena.free_blocks.erase(best);
+    arena.free_bytes -= header->capacity;
+    arena.live.insert(header->capacity);
+    return header;
+}
+
+} // namespace
+
+bool parse_huge_pages(const std::string &name, HugePages &mode) {
+    if (name == "off") mode = HugePages::Off;
+    else if (name == "thp") mode = HugePages::Transparent;
+    else if (name == "explicit") mode = HugePages::Explicit;
+    else return false;
+    return true;
+}
+
+const char *huge_pages_name(HugePages mode) {
+    switch (mode) {
+        case HugePages::Transparent: return "thp";
+        case HugePages::Explicit: return "explicit";
+        default: return "off";
+    }
+}
+
+void set_huge_pages(HugePages mode) {
+    g_huge_pages.store(mode);
+}
+
+HugePages current_huge_pages() {
+    return g_huge_pages.load();
+}
+
+/**
+ * Hands out an uninitialised, 64-byte-aligned buffer. Large requests are first
+ * served from the free blocks of the calling thread's arena; only if none fits
+ * is a new block reserved.
+ *
+ * @param bytes Requested size.
+ * @return Buffer, nullptr for 0 bytes or if out of memory.
+ */
+void *plane_arena_alloc(size_t bytes) {
+    if (bytes == 0) return nullptr;
+    if (bytes < MIN_ARENA_BYTES) {
+        BlockHeader *header = new_block(bytes, nullptr);
+        return header ? data_of(header) : nullptr;
+    }
+
+    PlaneArena *arena = current_arena();
+    if (BlockHeader *header = take_block(*arena, bytes)) {
+        g_reuses.fetch_add(1, std::memory_order_relaxed);
+        header->size = bytes;
+        return data_of(header);
+    }
+    BlockHeader *header = new_block(bytes, arena);
+    if (!header) return nullptr;
+    std::lock_guard<std::mutex> lock(arena->mutex);
+    arena->live.insert(header->capacity);
+    return data_of(header);
+}
+
+/**
+ * Grows or shrinks a buffer like realloc. The block is kept while it is large
+ * enough; otherwise the contents move to a new buffer.
+ */
+void *plane_arena_realloc(void *ptr, size_t bytes) {
+    if (!ptr) return plane_arena_alloc(bytes);
+    if (bytes == 0) {
+        plane_arena_free(ptr);
+        return nullptr;
+    }
+    BlockHeader *header = header_of(ptr);
+    if (bytes <= header->capacity) {
+        header->size = bytes;
+        return ptr;
+    }
+    void *moved = plane_arena_alloc(bytes);
+    if (!moved) return nullptr;
+    std::memcpy(moved, ptr, header->size);
+    plane_arena_free(ptr);
+    return moved;
+}
+
+/**
+ * Returns a buffer to the arena of the thread that reserved it (which may be a
+ * different thread than the caller). The arena keeps at most MAX_FREE_BLOCKS
+ * free blocks and MAX_FREE_PLANES times its largest live or just released
+ * block in bytes; the oldest blocks beyond that are released. Small heap blocks,
+ * and blocks of a thread that has exited, are freed right away.
+ */
+void plane_arena_free(void *ptr) {
+    if (!ptr) return;
+    BlockHeader *header = header_of(ptr);
+    PlaneArena *arena = header->owner;
+    if (!arena) {
+        destroy_block(header);
+        return;
+    }
+
+    std::vector<BlockHeader *> evicted;
+    bool release_arena = false;
+    {
+        std::lock_guard<std::mutex> lock(arena->mutex);
+        arena->live.erase(arena->live.find(header->capacity));
+        if (arena->orphaned) {
+            evicted.push_back(header);
+            release_arena = arena->live.empty();
+        } else {
+            arena->free_blocks.push_back(header);
+            arena->free_bytes += header->capacity;
+            const size_t largest = std::max(header->capacity, arena->live.empty() ? 0 : *arena->live.rbegin());
+            while (arena->free_blocks.size() > MAX_FREE_BLOCKS || arena->free_bytes > MAX_FREE_PLANES * largest) {
+                evicted.push_back(arena->free_blocks.front());
+                arena->free_bytes -= evicted.back()->capacity;
+                arena->free_blocks.erase(arena->free_blocks.begin());
+            }
+        }
+    }
+    for (BlockHeader *block : evicted) destroy_block(block);
+    if (release_arena) delete arena;
+}
+
+size_t plane_arena_capacity(const void *ptr) {
+    return ptr ? header_of(ptr)->capacity : 0;
+}
+
+PlaneArenaStats plane_arena_stats() {
+    return {g_allocations.load(), g_reuses.load(), g_reserved_bytes.load(), g_huge_page_bytes.load()};
+}
+
+void log_plane_arena_stats() {
+    const PlaneArenaStats stats = plane_arena_stats();
+    spdlog::info("Plane arena (huge pages {}): {} block(s) allocated, {} reused, {:.1f} MB reserved, {:.1f} MB on huge pages",
+                 huge_pages_name(current_huge_pages()), stats.allocations, stats.reuses,
+                 stats.reserved_bytes / 1048576.0, stats.huge_page_bytes / 1048576.0);
+}
@@ -1,3 +1,15 @@
+#include <utils/perf_report.h>
+#include <utils/plane_arena.h>
+
+// Allocations of the decoder and encoders count towards the performance report.
+// Decoded images come from the plane arena, so the next image reuses their blocks.
+#define STBI_MALLOC(size) plane_arena_alloc(size)
+#define STBI_REALLOC(ptr, size) plane_arena_realloc(ptr, size)
+#define STBI_FREE(ptr) plane_arena_free(ptr)
+#define STBIW_MALLOC(size) perf_malloc(size)
+#define STBIW_REALLOC(ptr, size) perf_realloc(ptr, size)
+#define STBIW_FREE(ptr) perf_free(ptr)
+
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
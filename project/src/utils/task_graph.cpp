@@ -0,0 +1,212 @@
+#include <utils/task_graph.h>
+#include <utils/perf_report.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <omp.h>
+#include <spdlog/spdlog.h>
+
+using Clock = std::chrono::high_resolution_clock;
+
+struct TaskGraph::RunState {
+    std::unique_ptr<std::atomic<int>[]> remaining;  // unfinished predecessors per node
+    int threads = 1;
+    Clock::time_point start;
+
+    std::mutex mutex;          // guards pending and running
+    int pending = 0;           // nodes that are ready or running
+    std::vector<int> running;  // started, unfinished nodes in start order
+};
+
+namespace {
+
+// Node executed by the calling thread; set for the duration of its work
+struct NodeContext {
+    TaskGraph::RunState *state = nullptr;
+    int node = -1;
+    TaskGraph::NodeTiming *timing = nullptr;
+    int limit = 0;  // ThreadLimit of the node, 0 = none
+};
+
+thread_local NodeContext t_node;
+
+/**
+ * Equal share of the pool among the nodes that are ready or running. The
+ * remainder of the division goes to the nodes that have been running longest,
+ * so no thread is left idle.
+ */
+int node_share(TaskGraph::RunState &state, int node) {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    const int pending = std::max(1, state.pending);
+    const int rank = static_cast<int>(std::find(state.running.begin(), state.running.end(), node) - state.running.begin());
+    return std::max(1, state.threads / pending + (rank < state.threads % pending ? 1 : 0));
+}
+
+} // namespace
+
+void task_graph_rebalance() {
+    if (!t_node.state) return;
+    int share = node_share(*t_node.state, t_node.node);
+    if (t_node.limit > 0) share = std::min(share, t_node.limit);
+    omp_set_num_threads(share);
+    t_node.timing->threads = std::max(t_node.timing->threads, share);
+}
+
+ThreadLimit::ThreadLimit(int threads) : previous_threads_(omp_get_max_threads()), previous_limit_(t_node.limit) {
+    if (t_node.state) {
+        t_node.limit = threads;
+        task_graph_rebalance();
+    } else {
+        omp_set_num_threads(threads);
+    }
+}
+
+ThreadLimit::~ThreadLimit() {
+    if (t_node.state) {
+        t_node.limit = previous_limit_;
+        task_graph_rebalance();
+    } else {
+        omp_set_num_threads(previous_threads_);
+    }
+}
+
+int TaskGraph::add(const std::string &name, std::function<void()> work, const std::vector<int> &deps) {
+    const int index = static_cast<int>(nodes_.size());
+    nodes_.push_back({name, std::move(work), deps, {}});
+    for (int dep : deps) nodes_[dep].successors.push_back(index);
+    return index;
+}
+
+/**
+ * Runs one node as an OpenMP task and launches every successor whose last
+ * predecessor it was. Parallel regions inside the node get an equal share of
+ * the pool among the nodes that are ready or running, so two methods side by
+ * side do not oversubscribe the machine. A node with several stages takes its
+ * share again between them (task_graph_rebalance) and so picks up the threads
+ * of nodes that finished in the meantime.
+ */
+void TaskGraph::launch(int node, RunState &state) {
+    #pragma omp task firstprivate(node) shared(state)
+    {
+        NodeTiming &timing = timings_[node];
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.running.push_back(node);
+        }
+        const NodeContext previous = t_node;
+        t_node = {&state, node, &timing, 0};
+        task_graph_rebalance();
+
+        timing.start = std::chrono::duration<double>(Clock::now() - state.start).count();
+        try {
+            PerfJob job(nodes_[node].name);
+            nodes_[node].work();
+        } catch (const std::exception &e) {
+            spdlog::error("Task {} failed: {}", nodes_[node].name, e.what());
+        }
+        timing.end = std::chrono::duration<double>(Clock::now() - state.start).count();
+        t_node = previous;
+
+        std::vector<int> ready;
+        for (int successor : nodes_[node].successors) {
+            if (state.remaining[successor].fetch_sub(1) == 1) ready.push_back(successor);
+        }
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.running.erase(std::find(state.running.begin(), state.running.end(), node));
+            state.pending += static_cast<int>(ready.size()) - 1;
+        }
+        for (int successor : ready) launch(successor, state);
+    }
+}
+
+/**
+ * Executes the graph on one OpenMP team. The nodes run as tasks with nested
+ * parallel regions enabled, so a serial phase of one node (e.g. a PNG write)
+ * overlaps with the parallel kernels of another. The implicit barrier at the end
+ * of the region waits for all tasks, including successors launched by tasks.
+ */
+void TaskGraph::run() {
+    const int count = static_cast<int>(nodes_.size());
+    timings_.assign(count, NodeTiming{});
+    if (count == 0) return;
+
+    RunState state;
+    state.remaining.reset(new std::atomic<int>[count]);
+    std::vector<int> roots;
+    for (int i = 0; i < count; ++i) {
+        state.remaining[i].store(static_cast<int>(nodes_[i].deps.size()));
+        if (nodes_[i].deps.empty()) roots.push_back(i);
+    }
+    state.pending = static_cast<int>(roots.size());
+    state.threads = omp_get_max_threads();
+
+    const int previous_levels = omp_get_max_active_levels();
+    omp_set_max_active_levels(std::max(previous_levels, 2));
+    perf_report_set_overlapping(true);
+    state.start = Clock::now();
+
+    // One pool thread per node at most; the remaining threads join the nested regions
+    #pragma omp parallel num_threads(std::min(state.threads, count))
+    {
+        #pragma omp single
+        {
+            for (int root : roots) launch(root, state);
+        }
+    }
+
+    wall_seconds_ = std::chrono::duration<double>(Clock::now() - state.start).count();
+    perf_report_set_overlapping(false);
+    omp_set_max_active_levels(previous_levels);
+
+    // Log the schedule and the critical path
+    const std::vector<int> path = critical_path();
+    std::vector<bool> critical(count, false);
+    std::string chain;
+    for (int node : path) {
+        critical[node] = true;
+        chain += (chain.empty() ? "" : " -> ") + nodes_[node].name;
+    }
+    double busy_seconds = 0.0;
+    std::vector<TaskGraphNodeRecord> records;
+    for (int i = 0; i < count; ++i) {
+        const NodeTiming &t = timings_[i];
+        busy_seconds += t.end - t.start;
+        records.push_back({nodes_[i].name, t.start, t.end, t.threads, critical[i]});
+        spdlog::info("Task {}: {:.3f} s - {:.3f} s ({:.3f} s) on {} thread(s){}", nodes_[i].name, t.start, t.end,
+                     t.end - t.start, t.threads, critical[i] ? ", critical" : "");
+    }
+    spdlog::info("Task graph: {} node(s) in {:.3f} s, critical path {:.3f} s ({}), node time {:.3f} s",
+                 count, wall_seconds_, critical_path_seconds(), chain, busy_seconds);
+    perf_report_task_graph(records, critical_path_seconds(), wall_seconds_);
+}
+
+std::vector<int> TaskGraph::critical_path() const {
+    const int count = static_cast<int>(nodes_.size());
+    if (count == 0 || static_cast<int>(timings_.size()) != count) return {};
+
+    // Nodes are added after their dependencies, so index order is a topological order
+    std::vector<double> finish(count, 0.0);
+    std::vector<int> previous(count, -1);
+    for (int i = 0; i < count; ++i) {
+        for (int dep : nodes_[i].deps) {
+            if (previous[i] < 0 || finish[dep] > finish[previous[i]]) previous[i] = dep;
+        }
+        finish[i] = (previous[i] >= 0 ? finish[previous[i]] : 0.0) + (timings_[i].end - timings_[i].start);
+    }
+
+    int last = static_cast<int>(std::max_element(finish.begin(), finish.end()) - finish.begin());
+    std::vector<int> path;
+    for (int node = last; node >= 0; node = previous[node]) path.push_back(node);
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+double TaskGraph::critical_path_seconds() const {
+    double seconds = 0.0;
+    for (int node : critical_path()) seconds += timings_[node].end - timings_[node].start;
+    return seconds;
+}
@@ -0,0 +1,131 @@
+#include <utils/trace.h>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+#include <spdlog/spdlog.h>
+
+namespace {
+
+struct TraceEvent {
+    const char *name;
+    const char *category;
+    int64_t begin_ns;
+    int64_t end_ns;
+};
+
+// Events of one thread; only that thread appends, the export reads after the work is done
+struct ThreadBuffer {
+    int tid;
+    bool main;
+    std::vector<TraceEvent> events;
+};
+
+struct TraceRegistry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::set<std::string> names;
+    std::thread::id main_thread;
+    int64_t start_ns = 0;
+};
+
+TraceRegistry &registry() {
+    static TraceRegistry instance;
+    return instance;
+}
+
+thread_local ThreadBuffer *t_buffer = nullptr;
+
+// Registers the calling thread on its first span; the only locked step
+ThreadBuffer &thread_buffer() {
+    if (!t_buffer) {
+        TraceRegistry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.buffers.push_back(std::make_unique<ThreadBuffer>());
+        t_buffer = r.buffers.back().get();
+        t_buffer->tid = static_cast<int>(r.buffers.size());
+        t_buffer->main = std::this_thread::get_id() == r.main_thread;
+        t_buffer->events.reserve(4096);
+    }
+    return *t_buffer;
+}
+
+} // namespace
+
+namespace trace_detail {
+
+std::atomic<bool> enabled{false};
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void record(const char *name, const char *category, int64_t begin_ns, int64_t end_ns) {
+    thread_buffer().events.push_back({name, category, begin_ns, end_ns});
+}
+
+const char *intern(const std::string &name) {
+    TraceRegistry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    return r.names.insert(name).first->c_str();
+}
+
+} // namespace trace_detail
+
+void trace_enable() {
+    TraceRegistry &r = registry();
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.main_thread = std::this_thread::get_id();
+        r.start_ns = trace_detail::now_ns();
+    }
+    trace_detail::enabled.store(true, std::memory_order_relaxed);
+}
+
+/**
+ * Writes all recorded spans as complete ("X") events of one process, one track
+ * per thread, with timestamps in microseconds since trace_enable(). Threads are
+ * named by metadata events so that OpenMP workers show up as "worker N".
+ *
+ * @param path Output JSON file.
+ * @return false if the file could not be written.
+ */
+bool trace_write_chrome(const std::string &path) {
+    TraceRegistry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    std::ofstream json(path);
+    if (!json) {
+        spdlog::error("Failed to write trace: {}", path);
+        return false;
+    }
+
+    // Fixed notation: long runs would otherwise print timestamps in exponent form
+    json << std::fixed << std::setprecision(3);
+    json << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool first = true;
+    size_t events = 0;
+    for (const auto &buffer : r.buffers) {
+        json << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+             << buffer->tid << ", \"args\": {\"name\": \""
+             << (buffer->main ? std::string("main") : "worker " + std::to_string(buffer->tid)) << "\"}}";
+        first = false;
+
+        for (const TraceEvent &e : buffer->events) {
+            json << ",\n{\"name\": \"" << e.name << "\", \"cat\": \"" << e.category
+                 << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->tid
+                 << ", \"ts\": " << (e.begin_ns - r.start_ns) / 1000.0
+                 << ", \"dur\": " << (e.end_ns - e.begin_ns) / 1000.0 << "}";
+        }
+        events += buffer->events.size();
+    }
+    json << "\n]}\n";
+
+    spdlog::info("Trace with {} spans on {} thread(s) written to: {}", events, r.buffers.size(), path);
+    return static_cast<bool>(json);
+}